@@ -0,0 +1,94 @@
+#include "checksum/CRC32C.hpp"
+#include "db/DBImpl.hpp"
+#include "wal/WAL.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace lsmdb;
+
+template<typename Body>
+double timeSeconds(Body body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Reports raw CRC32C throughput, then what checksums cost the DB: the share
+// of put time spent checksumming WAL records, and the slowdown of random
+// gets that verify every block against gets that verify none. Tables are
+// uncompressed and memory-mapped, so each get verifies a block rather than
+// hitting the block cache: the worst case.
+int main(int argc, char** argv) {
+    size_t numKeys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    size_t numReads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+    std::string buffer(4096, '\0');
+    std::mt19937_64 rng(42);
+    for(auto& c : buffer) {
+        c = static_cast<char>(rng());
+    }
+    size_t rounds = 200000;
+    uint32_t crc = 0;
+    double crcSeconds = timeSeconds([&]() {
+        for(size_t i = 0; i < rounds; i++) {
+            crc = CRC32C::extend(crc, buffer);
+        }
+    });
+    std::cout << "crc32c (" << (CRC32C::hardwareAccelerated() ? "sse4.2" : "portable") << "): "
+              << buffer.size() * rounds / crcSeconds / (1 << 30) << " GiB/s (" << crc << ")\n";
+
+    std::filesystem::path dbPath = "/tmp/lsmdb_checksum_bench";
+    std::filesystem::remove_all(dbPath);
+
+    Options options;
+    options.compression = CompressionType::NONE;
+    options.blockCacheCapacity = 0;
+    options.writeBufferSize = 4 * 1024 * 1024;
+    std::string value(100, 'v');
+    auto keyOf = [](size_t i) {
+        return "key" + std::to_string(1000000000 + i);
+    };
+
+    DBImpl db(dbPath, options);
+    double putSeconds = timeSeconds([&]() {
+        for(size_t i = 0; i < numKeys; i++) {
+            db.put(keyOf(i), value);
+        }
+    });
+    std::string record;
+    WAL::encodeRecord(record, RecordType::PUT, keyOf(0), value);
+    double recordCrcSeconds = timeSeconds([&]() {
+        for(size_t i = 0; i < numKeys; i++) {
+            crc = CRC32C::extend(crc, record);
+        }
+    });
+    std::cout << "put: " << numKeys / putSeconds << " ops/s, checksums "
+              << 100.0 * recordCrcSeconds / putSeconds << "% of the time\n";
+    db.waitForCompaction();
+
+    double verified = 0;
+    double unverified = 0;
+    ReadOptions readOptions;
+    for(int pass = 0; pass < 6; pass++) {
+        readOptions.verifyChecksums = pass % 2 == 0;
+        std::mt19937_64 keys(pass / 2);
+        double seconds = timeSeconds([&]() {
+            for(size_t i = 0; i < numReads; i++) {
+                if(!db.get(readOptions, keyOf(keys() % numKeys))) {
+                    std::abort();
+                }
+            }
+        });
+        (readOptions.verifyChecksums ? verified : unverified) += seconds;
+    }
+    std::cout << "get: " << 3 * numReads / unverified << " ops/s unverified, "
+              << 3 * numReads / verified << " ops/s verified, overhead "
+              << 100.0 * (verified - unverified) / unverified << "%\n";
+
+    std::filesystem::remove_all(dbPath);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "db/DBImpl.hpp"
+#include "memtable/MemTable.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lsmdb;
+
+// Runs body(thread) on each of threads threads and returns the elapsed
+// seconds.
+template<typename Body>
+double runThreads(int threads, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; t++) {
+        workers.emplace_back(body, t);
+    }
+    for(auto& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Reports insert throughput against the number of writer threads, first
+// straight into one memtable, then through DB::put(). Every row inserts the
+// same number of keys, split across the threads, so the memtables compared
+// are the same size.
+int main(int argc, char** argv) {
+    size_t total = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 800000;
+    std::string value(100, 'v');
+
+    std::cout << "threads      memtable ops/s      db put ops/s\n";
+    for(int threads : {1, 2, 4, 8}) {
+        size_t perThread = total / threads;
+        MemTable memTable;
+        std::atomic<uint64_t> sequence{0};
+        double memTableSeconds = runThreads(threads, [&](int t) {
+            std::mt19937_64 rng(t);
+            for(size_t i = 0; i < perThread; i++) {
+                memTable.put("key" + std::to_string(rng()), value, sequence.fetch_add(1) + 1);
+            }
+        });
+
+        std::filesystem::path dbPath = "/tmp/lsmdb_concurrent_write_bench";
+        std::filesystem::remove_all(dbPath);
+        double dbSeconds;
+        {
+            DBImpl db(dbPath);
+            dbSeconds = runThreads(threads, [&](int t) {
+                std::mt19937_64 rng(t);
+                for(size_t i = 0; i < perThread; i++) {
+                    db.put("key" + std::to_string(rng()), value);
+                }
+            });
+        }
+        std::filesystem::remove_all(dbPath);
+
+        double ops = static_cast<double>(perThread) * threads;
+        std::cout << threads << "\t" << ops / memTableSeconds << "\t" << ops / dbSeconds << "\n";
+    }
+
+    return 0;
+}
\ No newline at end of file
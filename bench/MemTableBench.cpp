@@ -0,0 +1,83 @@
+#include "memtable/MemTable.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace lsmdb;
+
+namespace {
+
+// Average cost of looking up every key in keys, in ns.
+double timeLookups(const MemTable& memTable, const std::vector<std::string>& keys) {
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(const auto& key : keys) {
+        found += memTable.lookup(key).found();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if(found == static_cast<size_t>(-1)) {
+        std::cout << found;
+    }
+    return std::chrono::duration<double, std::nano>(elapsed).count() / keys.size();
+}
+
+}
+
+// Inserts random keys into one memtable and reports the average cost of an
+// insert for each successive batch, which should stay flat as it grows.
+// Then compares point lookups of present and absent keys with and without
+// the hash index.
+int main(int argc, char** argv) {
+    size_t total = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t batch = total / 10 > 0 ? total / 10 : 1;
+
+    MemTable memTable;
+    std::mt19937_64 rng(42);
+    std::string value(100, 'v');
+    uint64_t sequence = 0;
+
+    std::cout << "entries      ns/insert    memtable bytes\n";
+    for(size_t done = 0; done < total;) {
+        size_t n = std::min(batch, total - done);
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < n; i++) {
+            memTable.put("key" + std::to_string(rng()), value, ++sequence);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        done += n;
+
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / n;
+        std::cout << done << "\t" << ns << "\t" << memTable.getSize() << "\n";
+    }
+
+    std::vector<std::string> present;
+    std::vector<std::string> absent;
+    std::mt19937_64 keys(7);
+    for(size_t i = 0; i < total; i++) {
+        present.push_back("key" + std::to_string(keys()));
+        absent.push_back("key" + std::to_string(keys()) + "~");
+    }
+    std::vector<std::string> shuffled = present;
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+    std::cout << "\nindex   ns/insert    ns/hit    ns/miss    memtable bytes\n";
+    for(size_t buckets : {size_t(0), total}) {
+        MemTable indexed(buckets);
+        sequence = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(const auto& key : present) {
+            indexed.put(key, value, ++sequence);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double insertNs = std::chrono::duration<double, std::nano>(elapsed).count() / total;
+
+        std::cout << (buckets ? "hash" : "none") << "\t" << insertNs << "\t" << timeLookups(indexed, shuffled)
+                  << "\t" << timeLookups(indexed, absent) << "\t" << indexed.getSize() << "\n";
+    }
+
+    return 0;
+}
\ No newline at end of file
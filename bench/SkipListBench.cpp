@@ -0,0 +1,60 @@
+#include "arena/Arena.hpp"
+#include "skiplist/SkipList.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace lsmdb;
+
+// Fills a skiplist with random keys, then reports the throughput of point
+// lookups of present keys in random order, for each size given (1M and 10M
+// by default).
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes;
+    for(int i = 1; i < argc; i++) {
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if(sizes.empty()) {
+        sizes = {1000000, 10000000};
+    }
+    const size_t lookups = 2000000;
+
+    std::cout << "entries      ns/lookup    Mlookups/s\n";
+    for(size_t size : sizes) {
+        Arena arena;
+        SkipList list(&arena);
+        std::mt19937_64 rng(42);
+        std::vector<std::string> keys;
+        keys.reserve(size);
+        for(size_t i = 0; i < size; i++) {
+            keys.push_back("key" + std::to_string(rng()));
+            list.insert(keys.back(), i + 1, "value", false);
+        }
+
+        std::vector<const std::string*> order;
+        order.reserve(lookups);
+        for(size_t i = 0; i < lookups; i++) {
+            order.push_back(&keys[rng() % size]);
+        }
+
+        size_t found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(const std::string* key : order) {
+            found += list.find(*key) != nullptr;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if(found != lookups) {
+            std::cerr << "lookup missed a key\n";
+            return 1;
+        }
+
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / lookups;
+        std::cout << size << "\t" << ns << "\t" << 1000.0 / ns << "\n";
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -1,29 +1,63 @@
-#ifndef LSMDB_DB_HPP
-#define LSMDB_DB_HPP
-
-#include <memory>
-#include <string>
-#include <optional>
-#include <filesystem>
-
-namespace lsmdb {
-
-class DB {
-protected:
-    DB() = default;
-    DB(const DB&) = delete;
-    DB& operator=(const DB&) = delete;
-
-public:
-    static std::unique_ptr<DB> open(const std::filesystem::path& path);
-
-    virtual ~DB() = default;
-
-    virtual void remove(const std::string& key) = 0;
-    virtual void put(const std::string& key, const std::string& value) = 0;
-    virtual std::optional<std::string> get(const std::string& key) = 0;
-};
-
-}
-
+#ifndef LSMDB_DB_HPP
+#define LSMDB_DB_HPP
+
+#include <memory>
+#include <string>
+#include <optional>
+#include <filesystem>
+#include <future>
+#include <span>
+#include <vector>
+
+#include "Iterator.hpp"
+#include "Options.hpp"
+#include "Snapshot.hpp"
+#include "WriteBatch.hpp"
+
+namespace lsmdb {
+
+class DB {
+protected:
+    DB() = default;
+    DB(const DB&) = delete;
+    DB& operator=(const DB&) = delete;
+
+public:
+    static std::unique_ptr<DB> open(const std::filesystem::path& path, const Options& options = Options());
+
+    virtual ~DB() = default;
+
+    virtual void remove(const std::string& key) = 0;
+    virtual void put(const std::string& key, const std::string& value) = 0;
+    virtual std::optional<std::string> get(const std::string& key) = 0;
+    virtual std::optional<std::string> get(const ReadOptions& options, const std::string& key) = 0;
+
+    // Looks up a batch of keys at one sequence number, as get() would each
+    // one; values come back in the order of keys. Keys are resolved in
+    // sorted order, so each table is read once per batch rather than once
+    // per key.
+    virtual std::vector<std::optional<std::string>> multiGet(std::span<const std::string> keys) = 0;
+    virtual std::vector<std::optional<std::string>> multiGet(const ReadOptions& options, std::span<const std::string> keys) = 0;
+
+    // get() that returns once the memtables are searched, leaving table
+    // blocks not already in memory to be read in the background; many
+    // lookups can be in flight from one thread. The DB waits for them when
+    // destroyed.
+    virtual std::future<std::optional<std::string>> getAsync(const std::string& key) = 0;
+    virtual std::future<std::optional<std::string>> getAsync(const ReadOptions& options, const std::string& key) = 0;
+
+    virtual void write(const WriteBatch& batch) = 0;
+
+    // The iterator keeps the tables it was created over alive and never sees
+    // writes made after its creation.
+    virtual std::unique_ptr<Iterator> newIterator(const ReadOptions& options = ReadOptions()) = 0;
+
+    // Versions a snapshot can read are kept until it is released. Every
+    // snapshot must be released before the DB is destroyed.
+    virtual const Snapshot* getSnapshot() = 0;
+    virtual void releaseSnapshot(const Snapshot* snapshot) = 0;
+};
+
+}
+
 #endif
\ No newline at end of file
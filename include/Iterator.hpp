@@ -0,0 +1,35 @@
+#ifndef LSMDB_ITERATOR_HPP
+#define LSMDB_ITERATOR_HPP
+
+#include <string>
+#include <string_view>
+
+namespace lsmdb {
+
+// Ordered cursor over the live keys of a DB. key() and value() are valid
+// until the iterator is moved or destroyed.
+class Iterator {
+protected:
+    Iterator() = default;
+
+public:
+    Iterator(const Iterator&) = delete;
+    Iterator& operator=(const Iterator&) = delete;
+
+    virtual ~Iterator() = default;
+
+    virtual bool valid() const = 0;
+    virtual void seekToFirst() = 0;
+    virtual void seekToLast() = 0;
+    // Positions at the first key that is >= target.
+    virtual void seek(const std::string& target) = 0;
+    virtual void next() = 0;
+    virtual void prev() = 0;
+
+    virtual std::string_view key() const = 0;
+    virtual std::string_view value() const = 0;
+};
+
+}
+
+#endif
\ No newline at end of file
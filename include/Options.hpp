@@ -0,0 +1,120 @@
+#ifndef LSMDB_OPTIONS_HPP
+#define LSMDB_OPTIONS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "Statistics.hpp"
+
+namespace lsmdb {
+
+class Snapshot;
+
+enum class WalSyncMode {
+    // Records reach the OS page cache; a machine crash can lose them.
+    NONE,
+    // A background thread fdatasyncs the log every walSyncIntervalMs.
+    PERIODIC,
+    // Every commit group is fdatasynced before its writers return.
+    EVERY_COMMIT
+};
+
+// Codec applied to each SSTable data block; stored per block, so tables
+// written with another setting stay readable.
+enum class CompressionType : uint8_t {
+    NONE = 0,
+    // Built-in LZ77 codec, needing no external library. Blocks that do not
+    // shrink by at least 1/8 are stored uncompressed.
+    LZ = 1
+};
+
+struct Options {
+    // A memtable that reaches writeBufferSize becomes immutable and is
+    // flushed by a background thread while a fresh one takes writes. Writers
+    // only wait when maxImmutableMemTables (at least 1) are already queued.
+    size_t writeBufferSize = 64 * 1024 * 1024;
+    size_t maxImmutableMemTables = 2;
+
+    // Memtables also index the newest version of each key in a hash table,
+    // so point lookups (hits and misses alike) skip the skiplist search.
+    // The index is carved from the write buffer: about 1/32 of it for the
+    // buckets plus 32 bytes per distinct key.
+    bool memTableHashIndex = false;
+
+    // Concurrent writers are committed in groups: one leader writes all
+    // queued records with a single write (and sync, depending on the mode).
+    WalSyncMode walSyncMode = WalSyncMode::NONE;
+    uint32_t walSyncIntervalMs = 100;
+
+    // Each memtable has its own log, retired once its table is durable. Up
+    // to maxRecycledLogs retired logs are kept and written over by later
+    // ones, which then need no new blocks from the filesystem; the rest are
+    // deleted.
+    size_t maxRecycledLogs = 2;
+
+    // Once a group is logged, each of its writers inserts its own batch into
+    // the memtable, in parallel with the others.
+    bool concurrentMemTableWrites = true;
+
+    // Leveled compaction: L0 is compacted once it holds this many files,
+    // level N (N >= 1) once it exceeds maxBytesForLevelBase * 10^(N-1).
+    int level0CompactionTrigger = 4;
+    uint64_t maxBytesForLevelBase = 10 * 1024 * 1024;
+    uint64_t targetFileSize = 2 * 1024 * 1024;
+
+    // Approximate size of the data blocks SSTables are split into; lookups
+    // read one block, and the in-memory index holds one entry per block.
+    size_t blockSize = 4 * 1024;
+    // Keys within a block are stored as deltas against the key before them,
+    // with a full key every blockRestartInterval entries; lookups binary
+    // search those restart points, then scan at most this many entries.
+    size_t blockRestartInterval = 16;
+    CompressionType compression = CompressionType::LZ;
+
+    // Capacity in bytes of the LRU cache of data blocks shared by all tables
+    // of the DB; 0 disables caching. Blocks of memory-mapped tables are read
+    // straight from the mapping and bypass it.
+    size_t blockCacheCapacity = 8 * 1024 * 1024;
+
+    // Tables stay open between reads; at most maxOpenFiles are kept open (or
+    // mapped) at once, the least recently used being closed first.
+    size_t maxOpenFiles = 1000;
+    bool useMmapReads = true;
+
+    // getAsync() reads table blocks off the calling thread, with up to
+    // asyncReadQueueDepth reads in flight: through io_uring on Linux, or on
+    // asyncReadThreads threads where it is unavailable. Blocks of mapped
+    // tables are read in place on the calling thread.
+    size_t asyncReadQueueDepth = 64;
+    size_t asyncReadThreads = 4;
+
+    // Bloom filter bits stored per key in every new SSTable; 0 disables it.
+    // 10 bits per key gives roughly a 1% false positive rate.
+    size_t bloomBitsPerKey = 10;
+
+    // Counters are collected here when set; the DB creates its own otherwise.
+    std::shared_ptr<Statistics> statistics;
+};
+
+struct ReadOptions {
+    // Iterators only visit keys in [lowerBound, upperBound); files whose key
+    // range falls outside are never read.
+    std::optional<std::string> lowerBound;
+    std::optional<std::string> upperBound;
+
+    // Reads see the DB as of this snapshot when set, and as of the start of
+    // the read (or the iterator's creation) otherwise.
+    const Snapshot* snapshot = nullptr;
+
+    // Checks table blocks read from disk against their checksums, throwing
+    // on a mismatch. Blocks served from the block cache were checked when
+    // they entered it.
+    bool verifyChecksums = true;
+};
+
+}
+
+#endif
\ No newline at end of file
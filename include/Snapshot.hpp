@@ -0,0 +1,26 @@
+#ifndef LSMDB_SNAPSHOT_HPP
+#define LSMDB_SNAPSHOT_HPP
+
+#include <cstdint>
+
+namespace lsmdb {
+
+// Handle on the state of a DB at one point in time. Reads given it through
+// ReadOptions::snapshot ignore every later write. Obtained from
+// DB::getSnapshot() and handed back with DB::releaseSnapshot().
+class Snapshot {
+protected:
+    Snapshot() = default;
+    virtual ~Snapshot() = default;
+
+public:
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    // Sequence number of the last write the snapshot sees.
+    virtual uint64_t getSequenceNumber() const = 0;
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef LSMDB_STATISTICS_HPP
+#define LSMDB_STATISTICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace lsmdb {
+
+enum class Ticker : size_t {
+    // Point lookups the Bloom filter answered with "definitely absent".
+    BLOOM_FILTER_USEFUL,
+    // Point lookups the Bloom filter let through to the index.
+    BLOOM_FILTER_POSITIVE,
+    // Lookups the filter let through but the table did not contain.
+    BLOOM_FILTER_FALSE_POSITIVE,
+    // Data block reads served from / missing in the shared block cache.
+    BLOCK_CACHE_HIT,
+    BLOCK_CACHE_MISS,
+    // Records written to the WAL, the commit groups they were written in,
+    // and the fdatasync calls made on the log.
+    WAL_RECORDS,
+    WAL_GROUP_COMMITS,
+    WAL_SYNCS,
+    // Writes that waited for a flush because too many immutable memtables
+    // were queued.
+    WRITE_STALLS,
+    TICKER_COUNT
+};
+
+class Statistics {
+private:
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(Ticker::TICKER_COUNT)> tickers_{};
+
+public:
+    void record(Ticker ticker, uint64_t count = 1) {
+        tickers_[static_cast<size_t>(ticker)].fetch_add(count, std::memory_order_relaxed);
+    }
+
+    uint64_t get(Ticker ticker) const {
+        return tickers_[static_cast<size_t>(ticker)].load(std::memory_order_relaxed);
+    }
+
+    void reset() {
+        for (auto& ticker : tickers_) {
+            ticker.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef LSMDB_WRITEBATCH_HPP
+#define LSMDB_WRITEBATCH_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace lsmdb {
+
+// Ordered set of updates applied atomically by DB::write(): the whole batch
+// is logged as one WAL record, so after a crash either every update in it
+// is recovered or none is.
+class WriteBatch {
+private:
+    friend class WriteBatchInternal;
+
+    std::string rep_;
+
+public:
+    class Handler {
+    public:
+        virtual ~Handler() = default;
+        virtual void put(const std::string& key, const std::string& value) = 0;
+        virtual void remove(const std::string& key) = 0;
+    };
+
+    WriteBatch();
+
+    void put(const std::string& key, const std::string& value);
+    void remove(const std::string& key);
+    void append(const WriteBatch& other);
+    void clear();
+
+    size_t count() const;
+    size_t approximateSize() const;
+
+    // Replays the updates in the order they were added.
+    void iterate(Handler& handler) const;
+};
+
+}
+
+#endif
\ No newline at end of file
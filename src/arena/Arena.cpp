@@ -0,0 +1,92 @@
+#include "Arena.hpp"
+
+#include <cstdint>
+
+namespace lsmdb {
+
+Arena::Arena()
+    : current_(nullptr)
+    , memoryUsage_(0) {
+}
+
+Arena::~Arena() = default;
+
+char* Arena::allocate(size_t bytes) {
+    for(;;) {
+        Block* block = current_.load(std::memory_order_acquire);
+        if(block && block->used.load(std::memory_order_relaxed) + bytes <= block->size) {
+            size_t offset = block->used.fetch_add(bytes, std::memory_order_relaxed);
+            if(offset + bytes <= block->size) {
+                return block->data.get() + offset;
+            }
+        }
+        if(char* result = allocateFallback(bytes, block)) {
+            return result;
+        }
+    }
+}
+
+char* Arena::allocateAligned(size_t bytes) {
+    constexpr size_t align = alignof(std::max_align_t);
+    for(;;) {
+        Block* block = current_.load(std::memory_order_acquire);
+        if(block) {
+            // The padding is worked out from the offset seen before the
+            // fetch_add; if another allocation got in between, the reserved
+            // range may be too short to align within, and is skipped.
+            size_t seen = block->used.load(std::memory_order_relaxed);
+            size_t mod = reinterpret_cast<uintptr_t>(block->data.get() + seen) & (align - 1);
+            size_t slop = mod == 0 ? 0 : align - mod;
+            if(seen + slop + bytes <= block->size) {
+                size_t offset = block->used.fetch_add(slop + bytes, std::memory_order_relaxed);
+                if(offset + slop + bytes <= block->size) {
+                    uintptr_t start = reinterpret_cast<uintptr_t>(block->data.get() + offset);
+                    uintptr_t aligned = (start + align - 1) & ~static_cast<uintptr_t>(align - 1);
+                    if(aligned - start <= slop) {
+                        return reinterpret_cast<char*>(aligned);
+                    }
+                    continue;
+                }
+            }
+        }
+        // New blocks come from operator new[] and are already aligned.
+        if(char* result = allocateFallback(bytes, block)) {
+            return result;
+        }
+    }
+}
+
+char* Arena::allocateFallback(size_t bytes, Block* full) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Large objects get a block of their own so the rest of the current
+    // block is not wasted.
+    if(bytes > BLOCK_SIZE / 4) {
+        Block* block = allocateNewBlock(bytes);
+        block->used.store(bytes, std::memory_order_relaxed);
+        return block->data.get();
+    }
+    if(current_.load(std::memory_order_relaxed) != full) {
+        return nullptr;
+    }
+
+    Block* block = allocateNewBlock(BLOCK_SIZE);
+    block->used.store(bytes, std::memory_order_relaxed);
+    current_.store(block, std::memory_order_release);
+    return block->data.get();
+}
+
+Arena::Block* Arena::allocateNewBlock(size_t bytes) {
+    auto block = std::make_unique<Block>();
+    block->data = std::make_unique_for_overwrite<char[]>(bytes);
+    block->size = bytes;
+    block->used.store(0, std::memory_order_relaxed);
+    blocks_.push_back(std::move(block));
+    memoryUsage_.fetch_add(bytes + sizeof(Block), std::memory_order_relaxed);
+    return blocks_.back().get();
+}
+
+size_t Arena::memoryUsage() const {
+    return memoryUsage_.load(std::memory_order_relaxed);
+}
+
+}
\ No newline at end of file
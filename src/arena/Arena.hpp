@@ -0,0 +1,53 @@
+#ifndef LSMDB_ARENA_HPP
+#define LSMDB_ARENA_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lsmdb {
+
+// Bump allocator: memory is carved out of large blocks and released all at
+// once when the arena is destroyed. Several threads may allocate at once:
+// allocations bump the current block's offset atomically, and the lock is
+// taken only to start a new block.
+class Arena {
+private:
+    static constexpr size_t BLOCK_SIZE = 4096;
+
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+        // May run past size once the block is full.
+        std::atomic<size_t> used;
+    };
+
+    std::atomic<Block*> current_;
+    std::vector<std::unique_ptr<Block>> blocks_;
+    std::atomic<size_t> memoryUsage_;
+    std::mutex mutex_;
+
+    // Returns nullptr if full is no longer the current block.
+    char* allocateFallback(size_t bytes, Block* full);
+    Block* allocateNewBlock(size_t bytes);
+
+public:
+    Arena();
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    char* allocate(size_t bytes);
+    // Aligned for any object holding pointers or atomics.
+    char* allocateAligned(size_t bytes);
+
+    // Bytes of every block allocated so far, including their bookkeeping.
+    size_t memoryUsage() const;
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include "BlockCache.hpp"
+
+namespace lsmdb {
+
+size_t BlockKeyHash::operator()(const BlockKey& key) const {
+    uint64_t h = key.tableId * 0x9e3779b97f4a7c15ULL ^ key.offset;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+}
+
+BlockCache::BlockCache(size_t capacity) : cache_(capacity) {
+}
+
+std::shared_ptr<const std::string> BlockCache::lookup(uint64_t tableId, uint64_t offset) {
+    return cache_.lookup({tableId, offset});
+}
+
+std::shared_ptr<const std::string> BlockCache::insert(uint64_t tableId, uint64_t offset, std::string block) {
+    size_t charge = block.size() + sizeof(BlockKey);
+    return cache_.insert({tableId, offset}, std::make_shared<const std::string>(std::move(block)), charge);
+}
+
+size_t BlockCache::usage() {
+    return cache_.usage();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef LSMDB_BLOCKCACHE_HPP
+#define LSMDB_BLOCKCACHE_HPP
+
+#include "LRUCache.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace lsmdb {
+
+struct BlockKey {
+    uint64_t tableId;
+    uint64_t offset;
+
+    bool operator==(const BlockKey& other) const {
+        return tableId == other.tableId && offset == other.offset;
+    }
+};
+
+struct BlockKeyHash {
+    size_t operator()(const BlockKey& key) const;
+};
+
+// Uncompressed data blocks shared by every SSTable of a DB. Tables are
+// keyed by an id handed out when they are opened, so blocks of a deleted
+// file are never served for a new file that happens to reuse its name.
+class BlockCache {
+private:
+    LRUCache<BlockKey, std::string, BlockKeyHash> cache_;
+
+public:
+    explicit BlockCache(size_t capacity);
+
+    std::shared_ptr<const std::string> lookup(uint64_t tableId, uint64_t offset);
+    std::shared_ptr<const std::string> insert(uint64_t tableId, uint64_t offset, std::string block);
+    size_t usage();
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+#ifndef LSMDB_LRUCACHE_HPP
+#define LSMDB_LRUCACHE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace lsmdb {
+
+// Capacity-bounded LRU cache split into independently locked shards so
+// concurrent readers rarely contend. Values are handed out as shared_ptr,
+// so an entry evicted while in use stays alive until its last reader is done.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LRUCache {
+public:
+    using Handle = std::shared_ptr<const Value>;
+
+private:
+    static constexpr size_t NUM_SHARDS = 16;
+
+    struct Entry {
+        Key key;
+        Handle value;
+        size_t charge;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> lookup;
+        size_t capacity = 0;
+        size_t usage = 0;
+    };
+
+    std::array<Shard, NUM_SHARDS> shards_;
+    size_t numShards_;
+    Hash hash_;
+
+    Shard& shardFor(const Key& key) {
+        return shards_[hash_(key) % numShards_];
+    }
+
+    static void evict(Shard& shard) {
+        while(shard.usage > shard.capacity && !shard.entries.empty()) {
+            auto& victim = shard.entries.back();
+            shard.usage -= victim.charge;
+            shard.lookup.erase(victim.key);
+            shard.entries.pop_back();
+        }
+    }
+
+public:
+    // The shard capacities add up to capacity exactly, and a cache too
+    // small to give every shard an entry uses fewer shards.
+    explicit LRUCache(size_t capacity)
+        : numShards_(std::clamp<size_t>(capacity, 1, NUM_SHARDS)) {
+        for(size_t i = 0; i < numShards_; i++) {
+            shards_[i].capacity = capacity / numShards_ + (i < capacity % numShards_ ? 1 : 0);
+        }
+    }
+
+    LRUCache(const LRUCache&) = delete;
+    LRUCache& operator=(const LRUCache&) = delete;
+
+    Handle lookup(const Key& key) {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.lookup.find(key);
+        if(it == shard.lookup.end()) {
+            return nullptr;
+        }
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return it->second->value;
+    }
+
+    Handle insert(const Key& key, Handle value, size_t charge) {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.lookup.find(key);
+        if(it != shard.lookup.end()) {
+            shard.usage -= it->second->charge;
+            shard.entries.erase(it->second);
+            shard.lookup.erase(it);
+        }
+        shard.entries.push_front({key, value, charge});
+        shard.lookup.emplace(key, shard.entries.begin());
+        shard.usage += charge;
+        evict(shard);
+        return value;
+    }
+
+    void erase(const Key& key) {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.lookup.find(key);
+        if(it != shard.lookup.end()) {
+            shard.usage -= it->second->charge;
+            shard.entries.erase(it->second);
+            shard.lookup.erase(it);
+        }
+    }
+
+    size_t usage() {
+        size_t total = 0;
+        for(auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.usage;
+        }
+        return total;
+    }
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "CRC32C.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace lsmdb {
+
+namespace {
+
+constexpr uint32_t POLYNOMIAL = 0x82f63b78;
+constexpr uint32_t MASK_DELTA = 0xa282ead8;
+
+// tables[k][b] is the CRC of byte b followed by k zero bytes, so eight
+// input bytes are folded in with eight independent lookups.
+constexpr std::array<std::array<uint32_t, 256>, 8> makeTables() {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for(uint32_t b = 0; b < 256; b++) {
+        uint32_t crc = b;
+        for(int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+        }
+        tables[0][b] = crc;
+    }
+    for(uint32_t b = 0; b < 256; b++) {
+        for(int k = 1; k < 8; k++) {
+            uint32_t previous = tables[k - 1][b];
+            tables[k][b] = (previous >> 8) ^ tables[0][previous & 0xff];
+        }
+    }
+    return tables;
+}
+
+constexpr auto TABLES = makeTables();
+
+uint32_t extendPortable(uint32_t crc, const char* data, size_t size) {
+    const auto* p = reinterpret_cast<const uint8_t*>(data);
+    while(size >= 8) {
+        uint32_t low;
+        uint32_t high;
+        std::memcpy(&low, p, sizeof(low));
+        std::memcpy(&high, p + 4, sizeof(high));
+        low ^= crc;
+        crc = TABLES[7][low & 0xff] ^ TABLES[6][(low >> 8) & 0xff]
+            ^ TABLES[5][(low >> 16) & 0xff] ^ TABLES[4][low >> 24]
+            ^ TABLES[3][high & 0xff] ^ TABLES[2][(high >> 8) & 0xff]
+            ^ TABLES[1][(high >> 16) & 0xff] ^ TABLES[0][high >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while(size > 0) {
+        crc = (crc >> 8) ^ TABLES[0][(crc ^ *p++) & 0xff];
+        size--;
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+uint32_t extendHardware(uint32_t crc, const char* data, size_t size) {
+    uint64_t crc64 = crc;
+    while(size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        size -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+    while(size > 0) {
+        crc = _mm_crc32_u8(crc, static_cast<uint8_t>(*data++));
+        size--;
+    }
+    return crc;
+}
+#endif
+
+using ExtendFunction = uint32_t (*)(uint32_t, const char*, size_t);
+
+ExtendFunction chooseExtend() {
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("sse4.2")) {
+        return extendHardware;
+    }
+#endif
+    return extendPortable;
+}
+
+ExtendFunction extendFunction() {
+    static const ExtendFunction function = chooseExtend();
+    return function;
+}
+
+}
+
+uint32_t CRC32C::value(std::string_view data) {
+    return extend(0, data);
+}
+
+uint32_t CRC32C::extend(uint32_t crc, std::string_view data) {
+    return ~extendFunction()(~crc, data.data(), data.size());
+}
+
+uint32_t CRC32C::mask(uint32_t crc) {
+    return ((crc >> 15) | (crc << 17)) + MASK_DELTA;
+}
+
+uint32_t CRC32C::unmask(uint32_t masked) {
+    uint32_t rotated = masked - MASK_DELTA;
+    return (rotated >> 17) | (rotated << 15);
+}
+
+bool CRC32C::hardwareAccelerated() {
+    return extendFunction() != extendPortable;
+}
+
+}
\ No newline at end of file
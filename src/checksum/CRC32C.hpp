@@ -0,0 +1,27 @@
+#ifndef LSMDB_CRC32C_HPP
+#define LSMDB_CRC32C_HPP
+
+#include <cstdint>
+#include <string_view>
+
+namespace lsmdb {
+
+// CRC-32C (Castagnoli), computed with the SSE4.2 crc32 instruction when the
+// CPU has it and with slicing-by-8 tables otherwise.
+class CRC32C {
+public:
+    static uint32_t value(std::string_view data);
+    // CRC of the concatenation of the data crc was computed over and data.
+    static uint32_t extend(uint32_t crc, std::string_view data);
+
+    // Stored checksums are masked, since the CRC of data that embeds its
+    // own CRC is weak.
+    static uint32_t mask(uint32_t crc);
+    static uint32_t unmask(uint32_t masked);
+
+    static bool hardwareAccelerated();
+};
+
+}
+
+#endif
\ No newline at end of file
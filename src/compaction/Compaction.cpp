@@ -0,0 +1,222 @@
+#include "Compaction.hpp"
+#include "sstable/SSTableBuilder.hpp"
+
+#include "iterator/InternalIterator.hpp"
+#include "iterator/MergingIterator.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+namespace lsmdb {
+
+Compaction::Compaction(const Options& options, const TableContext& context)
+    : options_(options)
+    , context_(context) {
+}
+
+uint64_t Compaction::maxBytesForLevel(int level) const {
+    uint64_t result = options_.maxBytesForLevelBase;
+    for(int i = 1; i < level; i++) {
+        result *= 10;
+    }
+    return result;
+}
+
+bool Compaction::needsCompaction(const TableSet& tables) const {
+    if(tables.levels[0].size() >= static_cast<size_t>(options_.level0CompactionTrigger)) {
+        return true;
+    }
+    for(int level = 1; level < TableSet::NUM_LEVELS - 1; level++) {
+        if(tables.levelBytes(level) > maxBytesForLevel(level)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<CompactionJob> Compaction::pick(const TableSet& tables) {
+    int bestLevel = -1;
+    double bestScore = 1.0;
+
+    for(int level = 0; level < TableSet::NUM_LEVELS - 1; level++) {
+        double score;
+        if(level == 0) {
+            score = static_cast<double>(tables.levels[0].size()) / options_.level0CompactionTrigger;
+        } else {
+            score = static_cast<double>(tables.levelBytes(level)) / maxBytesForLevel(level);
+        }
+        if(score >= bestScore) {
+            bestScore = score;
+            bestLevel = level;
+        }
+    }
+
+    if(bestLevel < 0) {
+        return std::nullopt;
+    }
+
+    CompactionJob job;
+    job.level = bestLevel;
+
+    const auto& files = tables.levels[bestLevel];
+    if(bestLevel == 0) {
+        job.inputs = files;
+    } else {
+        // Round-robin through the key space so every range eventually moves down.
+        const TableFile* chosen = &files.front();
+        for(const auto& file : files) {
+            if(file.table->getLargestKey() > compactPointer_[bestLevel]) {
+                chosen = &file;
+                break;
+            }
+        }
+        job.inputs = tables.overlapping(bestLevel, chosen->table->getSmallestKey(), chosen->table->getLargestKey());
+    }
+
+    std::string smallest = job.inputs.front().table->getSmallestKey();
+    std::string largest = job.inputs.front().table->getLargestKey();
+    for(const auto& file : job.inputs) {
+        smallest = std::min(smallest, file.table->getSmallestKey());
+        largest = std::max(largest, file.table->getLargestKey());
+    }
+
+    job.parents = tables.overlapping(bestLevel + 1, smallest, largest);
+    compactPointer_[bestLevel] = largest;
+
+    // Parents may reach past the inputs, and their keys are merged too.
+    for(const auto& file : job.parents) {
+        smallest = std::min(smallest, file.table->getSmallestKey());
+        largest = std::max(largest, file.table->getLargestKey());
+    }
+    for(int level = bestLevel + 2; level < TableSet::NUM_LEVELS; level++) {
+        auto files = tables.overlapping(level, smallest, largest);
+        if(!files.empty()) {
+            job.deeperLevels.push_back(std::move(files));
+        }
+    }
+
+    return job;
+}
+
+std::vector<TableFile> Compaction::run(const CompactionJob& job, const PathAllocator& allocatePath) const {
+    // Sources are ordered newest first, so versions with equal sequence
+    // numbers (written before sequences were stored) keep their order.
+    std::vector<TableFile> sources;
+    if(job.level == 0) {
+        sources.assign(job.inputs.rbegin(), job.inputs.rend());
+    } else {
+        sources = job.inputs;
+        std::sort(sources.begin(), sources.end(), [](const TableFile& a, const TableFile& b) {
+            return a.number > b.number;
+        });
+    }
+    std::vector<TableFile> parents = job.parents;
+    std::sort(parents.begin(), parents.end(), [](const TableFile& a, const TableFile& b) {
+        return a.number > b.number;
+    });
+    sources.insert(sources.end(), parents.begin(), parents.end());
+
+    // Inputs are streamed a block at a time, so memory stays bounded by
+    // one block per source whatever their size. Their blocks are read once
+    // and are not worth evicting cached ones for.
+    std::vector<std::unique_ptr<InternalIterator>> children;
+    children.reserve(sources.size());
+    for(const auto& source : sources) {
+        children.push_back(source.table->newIterator(true, false));
+    }
+    auto input = newMergingIterator(std::move(children));
+
+    // Outputs are streamed to disk as entries are merged; a builder left
+    // unfinished by an error removes its file.
+    std::vector<TableFile> outputs;
+    std::unique_ptr<SSTableBuilder> builder;
+    uint64_t outputNumber = 0;
+    std::filesystem::path outputPath;
+
+    auto finishOutput = [&]() {
+        if(!builder) {
+            return;
+        }
+        builder->finish();
+        builder.reset();
+        outputs.push_back({outputNumber, std::make_shared<SSTable>(outputPath, context_)});
+    };
+
+    // Keys arrive in order, so each deeper level is scanned once.
+    std::vector<size_t> deeperPositions(job.deeperLevels.size(), 0);
+    auto keyMayBeDeeper = [&](std::string_view key) {
+        for(size_t i = 0; i < job.deeperLevels.size(); i++) {
+            const auto& files = job.deeperLevels[i];
+            size_t& pos = deeperPositions[i];
+            while(pos < files.size() && files[pos].table->getLargestKey() < key) {
+                pos++;
+            }
+            if(pos < files.size() && files[pos].table->getSmallestKey() <= key) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::string currentKey;
+    bool hasCurrentKey = false;
+    // Sequence number of the previous version of currentKey, if any.
+    std::optional<uint64_t> lastSequence;
+
+    try {
+        for(input->seekToFirst(); input->valid(); input->next()) {
+            std::string_view key = input->key();
+            bool deleted = input->deleted();
+            uint64_t sequence = input->sequence();
+            if(!hasCurrentKey || key != currentKey) {
+                // Outputs only end between keys, so every version of a key
+                // lands in the same table.
+                if(builder && builder->fileSize() >= options_.targetFileSize) {
+                    finishOutput();
+                }
+                currentKey = key;
+                hasCurrentKey = true;
+                lastSequence.reset();
+            }
+
+            // A version is needed while some snapshot reads it: it is dropped
+            // once a newer version is visible to every snapshot, and a
+            // tombstone that no snapshot predates has nothing left to hide
+            // once no deeper level may hold its key.
+            bool drop = (lastSequence && *lastSequence <= job.smallestSnapshot)
+                || (deleted && sequence <= job.smallestSnapshot && !keyMayBeDeeper(key));
+            lastSequence = sequence;
+            if(!drop) {
+                if(!builder) {
+                    std::tie(outputNumber, outputPath) = allocatePath(job.level + 1);
+                    builder = std::make_unique<SSTableBuilder>(outputPath, options_);
+                }
+                builder->add(key, input->value(), deleted, sequence);
+            }
+        }
+        finishOutput();
+    } catch(...) {
+        for(auto& output : outputs) {
+            output.table->markObsolete();
+        }
+        throw;
+    }
+
+    return outputs;
+}
+
+VersionEdit Compaction::makeEdit(const CompactionJob& job, const std::vector<TableFile>& outputs) {
+    VersionEdit edit;
+    for(const auto& file : job.inputs) {
+        edit.removeTable(job.level, file.number);
+    }
+    for(const auto& file : job.parents) {
+        edit.removeTable(job.level + 1, file.number);
+    }
+    for(const auto& file : outputs) {
+        edit.addTable(job.level + 1, file);
+    }
+    return edit;
+}
+
+}
\ No newline at end of file
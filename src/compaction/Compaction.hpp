@@ -0,0 +1,56 @@
+#ifndef LSMDB_COMPACTION_HPP
+#define LSMDB_COMPACTION_HPP
+
+#include "Options.hpp"
+#include "sstable/SSTable.hpp"
+#include "version/Version.hpp"
+#include "version/VersionEdit.hpp"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lsmdb {
+
+struct CompactionJob {
+    int level;
+    std::vector<TableFile> inputs;
+    std::vector<TableFile> parents;
+    // Tables below the output level overlapping the job's key range, one
+    // sorted run per level. A tombstone is kept while one may hold its key.
+    std::vector<std::vector<TableFile>> deeperLevels;
+    // Versions shadowed by a newer one no newer than this are dropped. Left at
+    // 0, only versions from tables without sequence numbers may be.
+    uint64_t smallestSnapshot = 0;
+};
+
+class Compaction {
+public:
+    using PathAllocator = std::function<std::pair<uint64_t, std::filesystem::path>(int level)>;
+
+private:
+    const Options& options_;
+    TableContext context_;
+    std::array<std::string, TableSet::NUM_LEVELS> compactPointer_;
+
+    uint64_t maxBytesForLevel(int level) const;
+
+public:
+    Compaction(const Options& options, const TableContext& context);
+
+    bool needsCompaction(const TableSet& tables) const;
+    std::optional<CompactionJob> pick(const TableSet& tables);
+
+    std::vector<TableFile> run(const CompactionJob& job, const PathAllocator& allocatePath) const;
+    // Replaces the job's inputs with its outputs one level down.
+    static VersionEdit makeEdit(const CompactionJob& job, const std::vector<TableFile>& outputs);
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -1,113 +1,1148 @@
-#include "DBImpl.hpp"
-#include "memtable/MemTable.hpp"
-#include "sstable/SSTable.hpp"
-#include "wal/WAL.hpp"
-#include <filesystem>
-
-namespace lsmdb {
-
-DBImpl::DBImpl(const std::filesystem::path& path) : path_(path), nextSSTableId_(1) {
-    std::filesystem::create_directories(path_);
-
-    auto walPath = path_ / "wal.log";
-    wal_ = std::make_unique<WAL>(walPath);
-    memTable_ = std::make_unique<MemTable>();
-
-    recoverFromWAL();
-    loadExistingSSTables();
-}
-
-DBImpl::~DBImpl() = default;
-
-void DBImpl::loadExistingSSTables() {
-    for (const auto& entry : std::filesystem::directory_iterator(path_)) {
-        if (entry.path().extension() == ".sst") {
-            auto sstable = std::make_unique<SSTable>(entry.path());
-            sstables_.push_back(std::move(sstable));
-            
-            std::string filename = entry.path().stem().string();
-            if (filename.find("sstable_") == 0) {
-                uint64_t id = std::stoull(filename.substr(8));
-                if (id >= nextSSTableId_) {
-                    nextSSTableId_ = id + 1;
-                }
-            }
-        }
-    }
-}
-
-void DBImpl::flush() {
-    std::lock_guard<std::mutex> lock(flushMutex_);
-    
-    if (memTable_->getSize() == 0) {
-        return;
-    }
-    
-    auto sstablePath = path_ / ("sstable_" + std::to_string(nextSSTableId_++) + ".sst");
-    
-    std::vector<SSTableEntry> entries;
-    auto* skiplist = memTable_->getSkipList();
-    auto* node = skiplist->getHead()->forward[0].load(std::memory_order_acquire);
-    
-    while (node) {
-        if (!node->key.empty()) {
-            entries.push_back({node->key, node->value, node->deleted});
-        }
-        node = node->forward[0].load(std::memory_order_acquire);
-    }
-    
-    SSTable::create(sstablePath, entries);
-    sstables_.push_back(std::make_unique<SSTable>(sstablePath));
-    
-    memTable_ = std::make_unique<MemTable>();
-    wal_->clear();
-}
-
-void DBImpl::shouldFlush() {
-    if (memTable_->getSize() >= MEMTABLE_FLUSH_THRESHOLD) {
-        flush();
-    }
-}
-
-void DBImpl::recoverFromWAL() {
-    auto records = wal_->recover();
-    for (const auto& record : records) {
-        if (record.type == RecordType::PUT) {
-            memTable_->put(record.key, record.value);
-        } else if (record.type == RecordType::DELETE) {
-            memTable_->remove(record.key);
-        }
-    }
-}
-
-void DBImpl::remove(const std::string& key) {
-    wal_->logDelete(key);
-    wal_->sync();
-    memTable_->remove(key);
-    shouldFlush();
-}
-
-void DBImpl::put(const std::string& key, const std::string& value) {
-    wal_->logPut(key, value);
-    wal_->sync();
-    memTable_->put(key, value);
-    shouldFlush();
-}
-
-std::optional<std::string> DBImpl::get(const std::string& key) {
-    auto result = memTable_->get(key);
-    if (result.has_value() || memTable_->isDeleted(key)) {
-        return result;
-    }
-    
-    for (auto it = sstables_.rbegin(); it != sstables_.rend(); ++it) {
-        auto value = (*it)->get(key);
-        if (value.has_value()) {
-            return value;
-        }
-    }
-    
-    return std::nullopt;
-}
-
+#include "DBImpl.hpp"
+#include "DBIterator.hpp"
+#include "WriteBatchInternal.hpp"
+#include "cache/BlockCache.hpp"
+#include "compaction/Compaction.hpp"
+#include "iterator/InternalIterator.hpp"
+#include "memtable/MemTable.hpp"
+#include "sstable/AsyncReader.hpp"
+#include "sstable/SSTable.hpp"
+#include "sstable/SSTableBuilder.hpp"
+#include "sstable/TableCache.hpp"
+#include "version/VersionSet.hpp"
+#include "wal/WAL.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+
+namespace lsmdb {
+
+namespace {
+
+constexpr size_t MAX_GROUP_COMMIT_BYTES = 1024 * 1024;
+// Log records are replayed this many at a time, split across threads once
+// each gets at least MIN_RECOVERY_RECORDS_PER_THREAD.
+constexpr size_t RECOVERY_BATCH_SIZE = 64 * 1024;
+constexpr size_t MIN_RECOVERY_RECORDS_PER_THREAD = 1024;
+// Memtable hash indexes get one bucket per this many bytes of write buffer.
+constexpr size_t HASH_INDEX_BYTES_PER_BUCKET = 256;
+
+// Applies a batch's records with consecutive sequence numbers.
+class MemTableInserter : public WriteBatch::Handler {
+private:
+    MemTable* memTable_;
+    uint64_t sequence_;
+
+public:
+    MemTableInserter(MemTable* memTable, uint64_t sequence) 
+        : memTable_(memTable)
+        , sequence_(sequence) {}
+
+    void put(const std::string& key, const std::string& value) override {
+        memTable_->put(key, value, sequence_++);
+    }
+
+    void remove(const std::string& key) override {
+        memTable_->remove(key, sequence_++);
+    }
+
+    uint64_t sequence() const { return sequence_; }
+};
+
+class SnapshotImpl : public Snapshot {
+private:
+    uint64_t sequence_;
+
+public:
+    explicit SnapshotImpl(uint64_t sequence) : sequence_(sequence) {}
+    ~SnapshotImpl() override = default;
+
+    uint64_t getSequenceNumber() const override { return sequence_; }
+};
+
+std::string encodeSequence(uint64_t sequence) {
+    std::string result(sizeof(uint64_t), '\0');
+    for (size_t i = 0; i < sizeof(uint64_t); i++) {
+        result[i] = static_cast<char>(sequence >> (8 * i));
+    }
+    return result;
+}
+
+// Number of a log named wal_<number>.log; the single wal.log of older
+// versions counts as 0.
+uint64_t logNumberOf(const std::filesystem::path& path) {
+    std::string stem = path.stem().string();
+    return stem.find("wal_") == 0 ? std::stoull(stem.substr(4)) : 0;
+}
+
+uint64_t decodeSequence(std::string_view encoded) {
+    if (encoded.size() != sizeof(uint64_t)) {
+        throw std::runtime_error("Corrupt WAL batch sequence");
+    }
+    uint64_t sequence = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); i++) {
+        sequence |= static_cast<uint64_t>(static_cast<uint8_t>(encoded[i])) << (8 * i);
+    }
+    return sequence;
+}
+
+// Inserts records [begin, end) of a replayed log, each numbered from its
+// entry in sequences. Every version carries its sequence number, so the
+// memtable ends up the same whatever order records go in.
+void insertRecords(MemTable* memTable, const std::vector<WalRecordView>& records, const std::vector<uint64_t>& sequences, size_t begin, size_t end) {
+    std::string key;
+    std::string value;
+    for (size_t i = begin; i < end; i++) {
+        const WalRecordView& record = records[i];
+        if (record.type == RecordType::PUT) {
+            key.assign(record.key);
+            value.assign(record.value);
+            memTable->put(key, value, sequences[i]);
+        } else if (record.type == RecordType::DELETE) {
+            key.assign(record.key);
+            memTable->remove(key, sequences[i]);
+        } else if (record.type == RecordType::BATCH || record.type == RecordType::SEQUENCED_BATCH) {
+            MemTableInserter inserter(memTable, sequences[i]);
+            WriteBatchInternal::iterate(record.value, inserter);
+        }
+    }
+}
+
+// A getAsync() past the memtables: the tables left to search, newest first,
+// and the one being searched.
+struct AsyncLookup : std::enable_shared_from_this<AsyncLookup> {
+    std::string key;
+    uint64_t sequence;
+    bool verifyChecksums;
+    // Keeps the tables alive until the lookup is done.
+    std::shared_ptr<const TableSet> tables;
+    std::vector<const SSTable*> candidates;
+    size_t next = 0;
+    AsyncReader* reader;
+    std::promise<std::optional<std::string>> promise;
+
+    void answer(LookupResult& result) {
+        if (result.found()) {
+            promise.set_value(std::move(result.value));
+        } else {
+            promise.set_value(std::nullopt);
+        }
+    }
+
+    void start() {
+        try {
+            for (; next < candidates.size(); next++) {
+                LookupResult result;
+                BlockRead read;
+                if (!candidates[next]->startLookup(key, sequence, verifyChecksums, result, read)) {
+                    wait(read);
+                    return;
+                }
+                if (!result.absent()) {
+                    answer(result);
+                    return;
+                }
+            }
+            promise.set_value(std::nullopt);
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    }
+
+    void wait(const BlockRead& read) {
+        auto self = shared_from_this();
+        reader->read(read.file, read.offset, read.size, [self, read](std::string data, std::exception_ptr error) {
+            self->resume(read, std::move(data), error);
+        });
+    }
+
+    void resume(const BlockRead& read, std::string data, std::exception_ptr error) {
+        try {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            LookupResult result;
+            BlockRead nextRead;
+            if (!candidates[next]->continueLookup(key, sequence, verifyChecksums, read, std::move(data), result, nextRead)) {
+                wait(nextRead);
+                return;
+            }
+            if (!result.absent()) {
+                answer(result);
+                return;
+            }
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            return;
+        }
+        next++;
+        start();
+    }
+};
+
+}
+
+struct DBImpl::Writer {
+    const WriteBatch* batch;
+    bool done;
+    // First sequence number of the batch, assigned by the group leader.
+    uint64_t sequence;
+    // Set by the leader when this writer is to insert its own batch.
+    MemTable* memTable;
+    std::exception_ptr error;
+    std::condition_variable cv;
+
+    explicit Writer(const WriteBatch* b) 
+        : batch(b)
+        , done(false)
+        , sequence(0)
+        , memTable(nullptr) {}
+};
+
+std::unique_ptr<DB> DB::open(const std::filesystem::path& path, const Options& options) {
+    return std::make_unique<DBImpl>(path, options);
+}
+
+DBImpl::DBImpl(const std::filesystem::path& path, const Options& options)
+    : options_(options)
+    , path_(path)
+    , memTable_(newMemTable())
+    , immutables_(std::make_shared<ImmutableList>())
+    , flushStopped_(false)
+    , pendingInserts_(0)
+    , syncStopped_(false)
+    , compactionScheduled_(false)
+    , compactionRunning_(false)
+    , shuttingDown_(false)
+    , nextFileNumber_(1)
+    , firstOwnLogNumber_(0)
+    , lastSequence_(0) {
+    if (!options_.statistics) {
+        options_.statistics = std::make_shared<Statistics>();
+    }
+    tableContext_.statistics = options_.statistics.get();
+    if (options_.blockCacheCapacity > 0) {
+        blockCache_ = std::make_unique<BlockCache>(options_.blockCacheCapacity);
+        tableContext_.blockCache = blockCache_.get();
+    }
+    tableCache_ = std::make_unique<TableCache>(options_.maxOpenFiles, options_.useMmapReads);
+    tableContext_.tableCache = tableCache_.get();
+    std::filesystem::create_directories(path_);
+
+    compaction_ = std::make_unique<Compaction>(options_, tableContext_);
+    versions_ = std::make_unique<VersionSet>(path_);
+
+    loadExistingSSTables();
+    recoverFromWAL();
+
+    flushThread_ = std::thread(&DBImpl::flushLoop, this);
+    compactionThread_ = std::thread(&DBImpl::compactionLoop, this);
+    scheduleCompaction();
+
+    if (options_.walSyncMode == WalSyncMode::PERIODIC) {
+        syncThread_ = std::thread(&DBImpl::syncLoop, this);
+    }
+}
+
+DBImpl::~DBImpl() {
+    // Lookups still reading use the block cache.
+    asyncReader_.reset();
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        flushStopped_ = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(compactionMutex_);
+        shuttingDown_ = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(syncMutex_);
+        syncStopped_ = true;
+    }
+    flushCv_.notify_all();
+    compactionCv_.notify_all();
+    syncCv_.notify_all();
+    if (flushThread_.joinable()) {
+        flushThread_.join();
+    }
+    if (compactionThread_.joinable()) {
+        compactionThread_.join();
+    }
+    if (syncThread_.joinable()) {
+        syncThread_.join();
+    }
+
+    if (options_.walSyncMode != WalSyncMode::NONE) {
+        try {
+            syncWal();
+        } catch (const std::exception&) {
+        }
+    }
+}
+
+std::filesystem::path DBImpl::tablePath(int level, uint64_t number) const {
+    auto filename = "sstable_" + std::to_string(number) + ".sst";
+    if (level == 0) {
+        return path_ / filename;
+    }
+    return path_ / ("level_" + std::to_string(level)) / filename;
+}
+
+std::filesystem::path DBImpl::logPath(uint64_t number) const {
+    return path_ / ("wal_" + std::to_string(number) + ".log");
+}
+
+std::filesystem::path DBImpl::recycledLogPath(uint64_t number) const {
+    return path_ / ("recycled_" + std::to_string(number) + ".log");
+}
+
+std::shared_ptr<WAL> DBImpl::newLog(uint64_t number) {
+    auto path = logPath(number);
+    std::filesystem::path recycled;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        if (!recycledLogs_.empty()) {
+            recycled = std::move(recycledLogs_.back());
+            recycledLogs_.pop_back();
+        }
+    }
+
+    std::shared_ptr<WAL> wal;
+    if (!recycled.empty()) {
+        std::filesystem::rename(recycled, path);
+        wal = std::make_shared<WAL>(path, number, true);
+    } else {
+        wal = std::make_shared<WAL>(path, number);
+        wal->preallocate(options_.writeBufferSize);
+    }
+    // Synced writes must not land in a file that comes back from a crash
+    // under another name, or not at all.
+    if (options_.walSyncMode != WalSyncMode::NONE) {
+        WAL::syncDirectory(path_);
+    }
+    return wal;
+}
+
+void DBImpl::retireLog(const std::filesystem::path& path) {
+    std::error_code ec;
+    uint64_t number = logNumberOf(path);
+    if (number >= firstOwnLogNumber_) {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        if (recycledLogs_.size() < options_.maxRecycledLogs) {
+            auto recycled = recycledLogPath(number);
+            std::filesystem::rename(path, recycled, ec);
+            if (!ec) {
+                recycledLogs_.push_back(std::move(recycled));
+                return;
+            }
+        }
+    }
+    std::filesystem::remove(path, ec);
+}
+
+void DBImpl::loadExistingSSTables() {
+    std::array<std::map<uint64_t, std::filesystem::path>, TableSet::NUM_LEVELS> files;
+    for (int level = 0; level < TableSet::NUM_LEVELS; level++) {
+        auto dir = level == 0 ? path_ : tablePath(level, 0).parent_path();
+        if (!std::filesystem::is_directory(dir)) {
+            continue;
+        }
+
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().extension() == ".tmp") {
+                std::filesystem::remove(entry.path());
+                continue;
+            }
+            if (entry.path().extension() != ".sst") {
+                continue;
+            }
+
+            std::string filename = entry.path().stem().string();
+            if (filename.find("sstable_") != 0) {
+                continue;
+            }
+
+            uint64_t id = std::stoull(filename.substr(8));
+            if (id >= nextFileNumber_) {
+                nextFileNumber_ = id + 1;
+            }
+            files[level][id] = entry.path();
+        }
+    }
+
+    auto tables = std::make_shared<TableSet>();
+    auto openTable = [&](int level, uint64_t number, const std::filesystem::path& path) {
+        auto table = std::make_shared<SSTable>(path, tableContext_);
+        if (table->getLargestSequence() > lastSequence_) {
+            lastSequence_ = table->getLargestSequence();
+        }
+        tables->levels[level].push_back({number, std::move(table)});
+    };
+
+    auto manifest = versions_->recover();
+    if (manifest) {
+        if (manifest->nextFileNumber > nextFileNumber_) {
+            nextFileNumber_ = manifest->nextFileNumber;
+        }
+        for (int level = 0; level < TableSet::NUM_LEVELS; level++) {
+            for (uint64_t number : manifest->levels[level]) {
+                auto it = files[level].find(number);
+                if (it == files[level].end()) {
+                    throw std::runtime_error("SSTable listed in MANIFEST is missing");
+                }
+                openTable(level, number, it->second);
+                files[level].erase(it);
+            }
+            // Written by a flush or compaction that never got installed.
+            for (const auto& [number, path] : files[level]) {
+                std::filesystem::remove(path);
+            }
+        }
+    } else {
+        // DBs from before the MANIFEST: every table on disk is live, and
+        // level 0 was flushed in file number order.
+        for (int level = 0; level < TableSet::NUM_LEVELS; level++) {
+            for (const auto& [number, path] : files[level]) {
+                openTable(level, number, path);
+            }
+        }
+    }
+
+    for (int level = 1; level < TableSet::NUM_LEVELS; level++) {
+        std::sort(tables->levels[level].begin(), tables->levels[level].end(), [](const TableFile& a, const TableFile& b) {
+            return a.table->getSmallestKey() < b.table->getSmallestKey();
+        });
+    }
+
+    versions_->open(std::move(tables), nextFileNumber_);
+}
+
+std::shared_ptr<const TableSet> DBImpl::currentTables() const {
+    return versions_->current();
+}
+
+std::shared_ptr<SSTable> DBImpl::writeLevel0Table(const MemTable& memTable, uint64_t number, uint64_t smallestSnapshot) {
+    auto sstablePath = tablePath(0, number);
+
+    // Older versions are only kept while a snapshot may still read them.
+    SSTableBuilder builder(sstablePath, options_);
+    std::string lastKey;
+    uint64_t lastSequence = 0;
+    auto iter = memTable.newIterator();
+    for (iter->seekToFirst(); iter->valid(); iter->next()) {
+        bool sameKey = builder.numEntries() > 0 && iter->key() == lastKey;
+        if (sameKey && lastSequence <= smallestSnapshot) {
+            continue;
+        }
+        if (!sameKey) {
+            lastKey.assign(iter->key());
+        }
+        lastSequence = iter->sequence();
+        builder.add(iter->key(), iter->value(), iter->deleted(), iter->sequence());
+    }
+    builder.finish();
+    return std::make_shared<SSTable>(sstablePath, tableContext_);
+}
+
+std::shared_ptr<MemTable> DBImpl::newMemTable() const {
+    size_t buckets = options_.memTableHashIndex ? std::max<size_t>(options_.writeBufferSize / HASH_INDEX_BYTES_PER_BUCKET, 1) : 0;
+    return std::make_shared<MemTable>(buckets);
+}
+
+void DBImpl::makeRoomForWrite() {
+    if (memTable_.load(std::memory_order_relaxed)->getSize() < options_.writeBufferSize) {
+        return;
+    }
+
+    // Logs of memtables waiting for a flush are not appended to again, so
+    // their tails are made durable now rather than by the sync thread.
+    if (options_.walSyncMode != WalSyncMode::NONE) {
+        syncWal();
+    }
+
+    uint64_t number = nextFileNumber_++;
+    auto wal = newLog(number);
+
+    size_t maxImmutables = std::max<size_t>(options_.maxImmutableMemTables, 1);
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    if (immutables_.load()->size() >= maxImmutables) {
+        options_.statistics->record(Ticker::WRITE_STALLS);
+        flushCv_.wait(lock, [&] { return immutables_.load()->size() < maxImmutables; });
+    }
+
+    // Queued before it is replaced, so readers always find it somewhere.
+    auto immutables = std::make_shared<ImmutableList>(*immutables_.load());
+    immutables->push_back({memTable_.load(), std::move(memTableLogs_)});
+    immutables_.store(std::move(immutables));
+    memTable_.store(newMemTable());
+    memTableLogs_ = {logPath(number)};
+    wal_ = std::move(wal);
+    lock.unlock();
+
+    flushCv_.notify_all();
+}
+
+void DBImpl::flushLoop() {
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    while (true) {
+        flushCv_.wait(lock, [this] { return flushStopped_ || !immutables_.load()->empty(); });
+        if (flushStopped_) {
+            break;
+        }
+
+        ImmutableMemTable immutable = immutables_.load()->front();
+        uint64_t snapshot = smallestSnapshot();
+        lock.unlock();
+
+        std::shared_ptr<SSTable> table;
+        uint64_t number = nextFileNumber_++;
+        try {
+            table = writeLevel0Table(*immutable.memTable, number, snapshot);
+            VersionEdit edit;
+            edit.addTable(0, {number, table});
+            edit.setNextFileNumber(nextFileNumber_);
+            versions_->logAndApply(edit);
+        } catch (const std::exception&) {
+            // The memtable stays readable and its logs stay on disk; retry
+            // after a pause instead of spinning on a failing disk.
+            lock.lock();
+            flushCv_.wait_for(lock, std::chrono::seconds(1), [this] { return flushStopped_; });
+            continue;
+        }
+
+        // The table is installed before the memtable is dropped, so readers
+        // always find the flushed writes somewhere.
+        lock.lock();
+        auto immutables = immutables_.load();
+        immutables_.store(std::make_shared<ImmutableList>(immutables->begin() + 1, immutables->end()));
+        // Scheduled before the flush is seen as done, so waitForCompaction()
+        // cannot slip in between.
+        scheduleCompaction();
+        lock.unlock();
+
+        for (const auto& log : immutable.logs) {
+            retireLog(log);
+        }
+
+        lock.lock();
+        flushCv_.notify_all();
+    }
+}
+
+void DBImpl::scheduleCompaction() {
+    {
+        std::lock_guard<std::mutex> lock(compactionMutex_);
+        compactionScheduled_ = true;
+    }
+    compactionCv_.notify_all();
+}
+
+void DBImpl::compactionLoop() {
+    std::unique_lock<std::mutex> lock(compactionMutex_);
+    while (true) {
+        compactionCv_.wait(lock, [this] { return compactionScheduled_ || shuttingDown_; });
+        if (shuttingDown_) {
+            break;
+        }
+
+        compactionScheduled_ = false;
+        compactionRunning_ = true;
+        lock.unlock();
+
+        bool more = false;
+        try {
+            more = compactOnce();
+        } catch (const std::exception&) {
+            // Inputs stay live; the next flush retries the compaction.
+            more = false;
+        }
+
+        lock.lock();
+        compactionRunning_ = false;
+        if (more) {
+            compactionScheduled_ = true;
+        }
+        compactionCv_.notify_all();
+    }
+}
+
+bool DBImpl::compactOnce() {
+    auto tables = currentTables();
+    if (!compaction_->needsCompaction(*tables)) {
+        return false;
+    }
+
+    auto job = compaction_->pick(*tables);
+    if (!job) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        job->smallestSnapshot = smallestSnapshot();
+    }
+
+    auto outputs = compaction_->run(*job, [this](int level) {
+        uint64_t id = nextFileNumber_++;
+        auto path = tablePath(level, id);
+        std::filesystem::create_directories(path.parent_path());
+        return std::make_pair(id, path);
+    });
+
+    // Flushes may have added level-0 tables since the job was picked, so the
+    // edit is applied to whatever is current at install time.
+    try {
+        VersionEdit edit = Compaction::makeEdit(*job, outputs);
+        edit.setNextFileNumber(nextFileNumber_);
+        versions_->logAndApply(edit);
+    } catch (...) {
+        for (const auto& output : outputs) {
+            output.table->markObsolete();
+        }
+        throw;
+    }
+
+    for (const auto& file : job->inputs) {
+        file.table->markObsolete();
+    }
+    for (const auto& file : job->parents) {
+        file.table->markObsolete();
+    }
+    return true;
+}
+
+void DBImpl::waitForCompaction() {
+    {
+        std::unique_lock<std::mutex> lock(stateMutex_);
+        flushCv_.wait(lock, [this] { return flushStopped_ || immutables_.load()->empty(); });
+    }
+
+    std::unique_lock<std::mutex> lock(compactionMutex_);
+    compactionCv_.wait(lock, [this] {
+        return shuttingDown_ || (!compactionScheduled_ && !compactionRunning_);
+    });
+}
+
+Statistics& DBImpl::getStatistics() const {
+    return *options_.statistics;
+}
+
+size_t DBImpl::numTablesAtLevel(int level) const {
+    return currentTables()->levels[level].size();
+}
+
+void DBImpl::recoverFromWAL() {
+    // Every log not yet deleted holds writes that never reached a table.
+    // The single wal.log of older versions predates all numbered logs.
+    std::vector<std::pair<uint64_t, std::filesystem::path>> logs;
+    for (const auto& entry : std::filesystem::directory_iterator(path_)) {
+        std::string filename = entry.path().filename().string();
+        if (filename == "wal.log") {
+            logs.push_back({0, entry.path()});
+        } else if (filename.find("wal_") == 0 && entry.path().extension() == ".log") {
+            uint64_t number = logNumberOf(entry.path());
+            if (number >= nextFileNumber_) {
+                nextFileNumber_ = number + 1;
+            }
+            logs.push_back({number, entry.path()});
+        } else if (filename.find("recycled_") == 0 && entry.path().extension() == ".log") {
+            if (recycledLogs_.size() < options_.maxRecycledLogs) {
+                recycledLogs_.push_back(entry.path());
+            } else {
+                std::filesystem::remove(entry.path());
+            }
+        }
+    }
+    std::sort(logs.begin(), logs.end());
+    // Logs found here may hold untagged records and are deleted once
+    // flushed; only later ones are recycled.
+    firstOwnLogNumber_ = nextFileNumber_;
+
+    // Batches carry their own sequence numbers; records from before those
+    // were logged are numbered after everything already in a table. Numbers
+    // are assigned in log order, after which records can be inserted by
+    // several threads at once.
+    uint64_t lastSequence = lastSequence_;
+    MemTable* memTable = memTable_.load().get();
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint64_t> sequences;
+    for (const auto& [number, path] : logs) {
+        WAL log(path, number);
+        log.replay(RECOVERY_BATCH_SIZE, [&](const std::vector<WalRecordView>& records) {
+            sequences.resize(records.size());
+            for (size_t i = 0; i < records.size(); i++) {
+                const WalRecordView& record = records[i];
+                uint64_t first = lastSequence + 1;
+                uint64_t count = 0;
+                if (record.type == RecordType::PUT || record.type == RecordType::DELETE) {
+                    count = 1;
+                } else if (record.type == RecordType::BATCH || record.type == RecordType::SEQUENCED_BATCH) {
+                    if (record.type == RecordType::SEQUENCED_BATCH) {
+                        first = decodeSequence(record.key);
+                    }
+                    count = WriteBatchInternal::count(record.value);
+                }
+                sequences[i] = first;
+                lastSequence = std::max(lastSequence, first + count - 1);
+            }
+
+            size_t threads = std::min(maxThreads, records.size() / MIN_RECOVERY_RECORDS_PER_THREAD);
+            if (threads <= 1) {
+                insertRecords(memTable, records, sequences, 0, records.size());
+                return;
+            }
+            std::vector<std::thread> workers;
+            std::vector<std::exception_ptr> errors(threads);
+            size_t perThread = (records.size() + threads - 1) / threads;
+            for (size_t t = 0; t < threads; t++) {
+                size_t begin = t * perThread;
+                size_t end = std::min(records.size(), begin + perThread);
+                workers.emplace_back([&, t, begin, end]() {
+                    try {
+                        insertRecords(memTable, records, sequences, begin, end);
+                    } catch (...) {
+                        errors[t] = std::current_exception();
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            for (const auto& error : errors) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+        });
+        memTableLogs_.push_back(path);
+    }
+    lastSequence_ = lastSequence;
+
+    // New writes go to the newest log; the recovered memtable is flushed
+    // like any other once it fills up.
+    if (logs.empty()) {
+        uint64_t number = nextFileNumber_++;
+        memTableLogs_.push_back(logPath(number));
+        wal_ = newLog(number);
+    } else {
+        wal_ = std::make_shared<WAL>(logs.back().second, logs.back().first);
+    }
+}
+
+void DBImpl::syncWal() {
+    std::shared_ptr<WAL> wal;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        wal = wal_;
+    }
+    wal->sync();
+    options_.statistics->record(Ticker::WAL_SYNCS);
+}
+
+void DBImpl::syncLoop() {
+    auto interval = std::chrono::milliseconds(options_.walSyncIntervalMs);
+    std::unique_lock<std::mutex> lock(syncMutex_);
+    while (!syncCv_.wait_for(lock, interval, [this] { return syncStopped_; })) {
+        lock.unlock();
+        try {
+            syncWal();
+        } catch (const std::exception&) {
+            // Retried on the next tick; writers are not blocked by it.
+        }
+        lock.lock();
+    }
+}
+
+void DBImpl::writeInternal(Writer& writer) {
+    std::unique_lock<std::mutex> lock(writeMutex_);
+    writers_.push_back(&writer);
+    writer.cv.wait(lock, [&] { return writer.done || writer.memTable || writers_.front() == &writer; });
+
+    if (writer.memTable) {
+        // The leader has logged this batch and hands its insert back, so the
+        // group's batches go into the memtable in parallel.
+        lock.unlock();
+        try {
+            MemTableInserter inserter(writer.memTable, writer.sequence);
+            writer.batch->iterate(inserter);
+        } catch (...) {
+            writer.error = std::current_exception();
+        }
+        lock.lock();
+        writer.memTable = nullptr;
+        if (--pendingInserts_ == 0) {
+            writers_.front()->cv.notify_one();
+        }
+        writer.cv.wait(lock, [&] { return writer.done; });
+    }
+
+    if (writer.done) {
+        if (writer.error) {
+            std::rethrow_exception(writer.error);
+        }
+        return;
+    }
+
+    // This writer leads the group: it commits its own record together with
+    // every record queued behind it, while later arrivals wait their turn.
+    size_t groupBytes = 0;
+    size_t groupSize = 0;
+    uint64_t sequence = lastSequence_.load(std::memory_order_relaxed) + 1;
+    for (Writer* queued : writers_) {
+        if (groupSize > 0 && groupBytes >= MAX_GROUP_COMMIT_BYTES) {
+            break;
+        }
+        queued->sequence = sequence;
+        sequence += queued->batch->count();
+        groupBytes += queued->batch->approximateSize();
+        groupSize++;
+    }
+    std::vector<Writer*> group(writers_.begin(), writers_.begin() + groupSize);
+    lock.unlock();
+
+    // An error before the insert fails the whole group; an insert error
+    // only fails the writer whose batch it was. Records are encoded once
+    // the log they go to is known, since they are tagged with its number.
+    std::exception_ptr error;
+    try {
+        makeRoomForWrite();
+        std::string records;
+        records.reserve(groupBytes + groupSize * 32);
+        for (Writer* member : group) {
+            WAL::encodeRecord(records, RecordType::SEQUENCED_BATCH, encodeSequence(member->sequence), WriteBatchInternal::contents(*member->batch), wal_->logNumber());
+        }
+        wal_->append(records);
+        options_.statistics->record(Ticker::WAL_RECORDS, groupSize);
+        options_.statistics->record(Ticker::WAL_GROUP_COMMITS);
+        if (options_.walSyncMode == WalSyncMode::EVERY_COMMIT) {
+            syncWal();
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    if (!error) {
+        std::shared_ptr<MemTable> active = memTable_.load(std::memory_order_relaxed);
+        MemTable* memTable = active.get();
+        bool parallel = options_.concurrentMemTableWrites && groupSize > 1;
+        if (parallel) {
+            lock.lock();
+            pendingInserts_ = groupSize - 1;
+            for (Writer* member : group) {
+                if (member != &writer) {
+                    member->memTable = memTable;
+                    member->cv.notify_one();
+                }
+            }
+            lock.unlock();
+        }
+
+        for (Writer* member : group) {
+            if (parallel && member != &writer) {
+                continue;
+            }
+            try {
+                MemTableInserter inserter(memTable, member->sequence);
+                member->batch->iterate(inserter);
+            } catch (...) {
+                member->error = std::current_exception();
+            }
+        }
+
+        if (parallel) {
+            lock.lock();
+            writer.cv.wait(lock, [this] { return pendingInserts_ == 0; });
+            lock.unlock();
+        }
+        lastSequence_.store(sequence - 1, std::memory_order_release);
+    }
+
+    lock.lock();
+    for (Writer* member : group) {
+        writers_.pop_front();
+        if (error) {
+            member->error = error;
+        }
+        if (member != &writer) {
+            member->done = true;
+            member->cv.notify_one();
+        }
+    }
+    if (!writers_.empty()) {
+        writers_.front()->cv.notify_one();
+    }
+    lock.unlock();
+
+    if (writer.error) {
+        std::rethrow_exception(writer.error);
+    }
+}
+
+void DBImpl::write(const WriteBatch& batch) {
+    if (batch.count() == 0) {
+        return;
+    }
+    Writer writer(&batch);
+    writeInternal(writer);
+}
+
+void DBImpl::remove(const std::string& key) {
+    WriteBatch batch;
+    batch.remove(key);
+    write(batch);
+}
+
+void DBImpl::put(const std::string& key, const std::string& value) {
+    WriteBatch batch;
+    batch.put(key, value);
+    write(batch);
+}
+
+std::optional<std::string> DBImpl::get(const std::string& key) {
+    return get(ReadOptions(), key);
+}
+
+std::optional<std::string> DBImpl::get(const ReadOptions& options, const std::string& key) {
+    // Loaded in the reverse order of installation, so a memtable being
+    // queued or flushed is never missed. The sequence comes last: no table
+    // loaded before it can lack a version visible at it.
+    auto memTable = memTable_.load(std::memory_order_acquire);
+    auto immutables = immutables_.load(std::memory_order_acquire);
+    auto tables = versions_->current();
+    uint64_t sequence = options.snapshot ? options.snapshot->getSequenceNumber() : lastSequence_.load(std::memory_order_acquire);
+
+    // The first source holding any version of the key answers, a tombstone
+    // included: everything older is shadowed by it.
+    auto answer = [](LookupResult& result) -> std::optional<std::string> {
+        if (result.found()) {
+            return std::move(result.value);
+        }
+        return std::nullopt;
+    };
+
+    LookupResult result = memTable->lookup(key, sequence);
+    if (!result.absent()) {
+        return answer(result);
+    }
+
+    for (auto it = immutables->rbegin(); it != immutables->rend(); ++it) {
+        result = it->memTable->lookup(key, sequence);
+        if (!result.absent()) {
+            return answer(result);
+        }
+    }
+
+    const auto& level0 = tables->levels[0];
+    for (auto it = level0.rbegin(); it != level0.rend(); ++it) {
+        result = it->table->lookup(key, sequence, options.verifyChecksums);
+        if (!result.absent()) {
+            return answer(result);
+        }
+    }
+
+    for (int level = 1; level < TableSet::NUM_LEVELS; level++) {
+        const TableFile* file = tables->findTable(level, key);
+        if (file) {
+            result = file->table->lookup(key, sequence, options.verifyChecksums);
+            if (!result.absent()) {
+                return answer(result);
+            }
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::vector<std::optional<std::string>> DBImpl::multiGet(std::span<const std::string> keys) {
+    return multiGet(ReadOptions(), keys);
+}
+
+std::vector<std::optional<std::string>> DBImpl::multiGet(const ReadOptions& options, std::span<const std::string> keys) {
+    // Same load order as get().
+    auto memTable = memTable_.load(std::memory_order_acquire);
+    auto immutables = immutables_.load(std::memory_order_acquire);
+    auto tables = versions_->current();
+    uint64_t sequence = options.snapshot ? options.snapshot->getSequenceNumber() : lastSequence_.load(std::memory_order_acquire);
+
+    std::vector<std::optional<std::string>> values(keys.size());
+    auto answer = [&values](size_t index, LookupResult& result) {
+        if (result.found()) {
+            values[index] = std::move(result.value);
+        }
+    };
+
+    // Indexes of the keys no source has answered yet, kept in key order.
+    std::vector<size_t> pending(keys.size());
+    std::iota(pending.begin(), pending.end(), 0);
+    std::sort(pending.begin(), pending.end(), [&keys](size_t a, size_t b) {
+        return keys[a] < keys[b];
+    });
+
+    std::vector<size_t> unresolved;
+    auto lookupMemTable = [&](const MemTable& source) {
+        unresolved.clear();
+        for (size_t index : pending) {
+            LookupResult result = source.lookup(keys[index], sequence);
+            if (result.absent()) {
+                unresolved.push_back(index);
+            } else {
+                answer(index, result);
+            }
+        }
+        pending.swap(unresolved);
+    };
+
+    lookupMemTable(*memTable);
+    for (auto it = immutables->rbegin(); it != immutables->rend(); ++it) {
+        lookupMemTable(*it->memTable);
+    }
+
+    // Hands a run of pending keys to one table in a single pass, keeping
+    // those it does not answer.
+    std::vector<std::string_view> batch;
+    std::vector<LookupResult> results;
+    auto lookupTable = [&](const SSTable& table, std::vector<size_t>::const_iterator begin, std::vector<size_t>::const_iterator end) {
+        batch.clear();
+        for (auto it = begin; it != end; ++it) {
+            batch.push_back(keys[*it]);
+        }
+        table.multiLookup(batch, sequence, options.verifyChecksums, results);
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (results[i].absent()) {
+                unresolved.push_back(begin[i]);
+            } else {
+                answer(begin[i], results[i]);
+            }
+        }
+    };
+    auto keyLess = [&keys](size_t index, const std::string& key) {
+        return keys[index] < key;
+    };
+    auto keyGreater = [&keys](const std::string& key, size_t index) {
+        return key < keys[index];
+    };
+
+    const auto& level0 = tables->levels[0];
+    for (auto it = level0.rbegin(); it != level0.rend() && !pending.empty(); ++it) {
+        auto first = std::lower_bound(pending.cbegin(), pending.cend(), it->table->getSmallestKey(), keyLess);
+        auto last = std::upper_bound(first, pending.cend(), it->table->getLargestKey(), keyGreater);
+        unresolved.assign(pending.cbegin(), first);
+        if (first != last) {
+            lookupTable(*it->table, first, last);
+        }
+        unresolved.insert(unresolved.end(), last, pending.cend());
+        pending.swap(unresolved);
+    }
+
+    // Files of a level are disjoint and sorted, so consecutive keys that
+    // fall in the same file form one run.
+    for (int level = 1; level < TableSet::NUM_LEVELS && !pending.empty(); level++) {
+        unresolved.clear();
+        auto it = pending.cbegin();
+        while (it != pending.cend()) {
+            const TableFile* file = tables->findTable(level, keys[*it]);
+            if (!file) {
+                unresolved.push_back(*it++);
+                continue;
+            }
+            auto last = std::upper_bound(it, pending.cend(), file->table->getLargestKey(), keyGreater);
+            lookupTable(*file->table, it, last);
+            it = last;
+        }
+        pending.swap(unresolved);
+    }
+
+    return values;
+}
+
+std::future<std::optional<std::string>> DBImpl::getAsync(const std::string& key) {
+    return getAsync(ReadOptions(), key);
+}
+
+std::future<std::optional<std::string>> DBImpl::getAsync(const ReadOptions& options, const std::string& key) {
+    // Same load order as get().
+    auto memTable = memTable_.load(std::memory_order_acquire);
+    auto immutables = immutables_.load(std::memory_order_acquire);
+    auto tables = versions_->current();
+    uint64_t sequence = options.snapshot ? options.snapshot->getSequenceNumber() : lastSequence_.load(std::memory_order_acquire);
+
+    auto lookup = std::make_shared<AsyncLookup>();
+    auto future = lookup->promise.get_future();
+
+    // Memtables need no reads, so they are searched right away.
+    LookupResult result = memTable->lookup(key, sequence);
+    for (auto it = immutables->rbegin(); it != immutables->rend() && result.absent(); ++it) {
+        result = it->memTable->lookup(key, sequence);
+    }
+    if (!result.absent()) {
+        lookup->answer(result);
+        return future;
+    }
+
+    const auto& level0 = tables->levels[0];
+    for (auto it = level0.rbegin(); it != level0.rend(); ++it) {
+        lookup->candidates.push_back(it->table.get());
+    }
+    for (int level = 1; level < TableSet::NUM_LEVELS; level++) {
+        if (const TableFile* file = tables->findTable(level, key)) {
+            lookup->candidates.push_back(file->table.get());
+        }
+    }
+
+    std::call_once(asyncReaderOnce_, [this]() {
+        asyncReader_ = std::make_unique<AsyncReader>(options_.asyncReadQueueDepth, options_.asyncReadThreads);
+    });
+    lookup->key = key;
+    lookup->sequence = sequence;
+    lookup->verifyChecksums = options.verifyChecksums;
+    lookup->tables = std::move(tables);
+    lookup->reader = asyncReader_.get();
+    lookup->start();
+    return future;
+}
+
+std::unique_ptr<Iterator> DBImpl::newIterator(const ReadOptions& options) {
+    // Same load order as get().
+    std::vector<std::shared_ptr<const MemTable>> memTables;
+    memTables.push_back(memTable_.load(std::memory_order_acquire));
+    auto immutables = immutables_.load(std::memory_order_acquire);
+    for (auto it = immutables->rbegin(); it != immutables->rend(); ++it) {
+        memTables.push_back(it->memTable);
+    }
+    auto tables = versions_->current();
+    uint64_t sequence = options.snapshot ? options.snapshot->getSequenceNumber() : lastSequence_.load(std::memory_order_acquire);
+    return newDBIterator(std::move(memTables), std::move(tables), options, sequence);
+}
+
+const Snapshot* DBImpl::getSnapshot() {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    uint64_t sequence = lastSequence_.load(std::memory_order_acquire);
+    snapshots_.insert(sequence);
+    return new SnapshotImpl(sequence);
+}
+
+void DBImpl::releaseSnapshot(const Snapshot* snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        auto it = snapshots_.find(snapshot->getSequenceNumber());
+        if (it != snapshots_.end()) {
+            snapshots_.erase(it);
+        }
+    }
+    delete static_cast<const SnapshotImpl*>(snapshot);
+}
+
+uint64_t DBImpl::smallestSnapshot() const {
+    if (snapshots_.empty()) {
+        return lastSequence_.load(std::memory_order_acquire);
+    }
+    return *snapshots_.begin();
+}
+
 }
\ No newline at end of file
@@ -1,45 +1,148 @@
-#ifndef LSMDB_DBIMPL_HPP
-#define LSMDB_DBIMPL_HPP
-
-#include "DB.hpp"
-
-#include <filesystem>
-#include <memory>
-#include <mutex>
-#include <vector>
-
-namespace lsmdb {
-
-class MemTable;
-class SSTable;
-class WAL;
-
-class DBImpl : public DB {
-private:
-    std::unique_ptr<MemTable> memTable_;
-    std::unique_ptr<WAL> wal_;
-    std::filesystem::path path_;
-    
-    std::vector<std::unique_ptr<SSTable>> sstables_;
-    std::mutex flushMutex_;
-
-    uint64_t nextSSTableId_;
-    static constexpr size_t MEMTABLE_FLUSH_THRESHOLD = 64 * 1024 * 1024;
-
-    void recoverFromWAL();
-    void loadExistingSSTables();
-    void flush();
-    void shouldFlush();
-
-public:
-    explicit DBImpl(const std::filesystem::path& path);
-    ~DBImpl() override;
-
-    void remove(const std::string& key) override;
-    void put(const std::string& key, const std::string& value) override;
-    std::optional<std::string> get(const std::string& key) override;
-};
-
-}
-
+#ifndef LSMDB_DBIMPL_HPP
+#define LSMDB_DBIMPL_HPP
+
+#include "DB.hpp"
+#include "sstable/SSTable.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace lsmdb {
+
+class MemTable;
+class WAL;
+class AsyncReader;
+class BlockCache;
+class TableCache;
+class Compaction;
+class VersionSet;
+struct TableSet;
+
+class DBImpl : public DB {
+private:
+    struct Writer;
+
+    // A full memtable waiting for the flush thread, with the logs that hold
+    // its writes; they are retired once its table is installed.
+    struct ImmutableMemTable {
+        std::shared_ptr<MemTable> memTable;
+        std::vector<std::filesystem::path> logs;
+    };
+    using ImmutableList = std::vector<ImmutableMemTable>;
+
+    Options options_;
+    std::shared_ptr<WAL> wal_;
+    std::filesystem::path path_;
+
+    std::unique_ptr<BlockCache> blockCache_;
+    std::unique_ptr<TableCache> tableCache_;
+    TableContext tableContext_;
+    
+    // Readers load memTable_, immutables_ and the current table set without
+    // locking. They are replaced under stateMutex_; only the write leader
+    // replaces memTable_ and wal_, and only it touches memTableLogs_.
+    std::atomic<std::shared_ptr<MemTable>> memTable_;
+    std::vector<std::filesystem::path> memTableLogs_;
+    std::atomic<std::shared_ptr<const ImmutableList>> immutables_;
+    std::unique_ptr<VersionSet> versions_;
+    // Sequence numbers of the live snapshots.
+    std::multiset<uint64_t> snapshots_;
+    // Retired logs waiting to be written over.
+    std::vector<std::filesystem::path> recycledLogs_;
+    mutable std::mutex stateMutex_;
+
+    std::thread flushThread_;
+    std::condition_variable flushCv_;
+    bool flushStopped_;
+
+    std::mutex writeMutex_;
+    std::deque<Writer*> writers_;
+    // Group members still inserting their own batches.
+    size_t pendingInserts_;
+
+    std::thread syncThread_;
+    std::mutex syncMutex_;
+    std::condition_variable syncCv_;
+    bool syncStopped_;
+
+    // Started by the first getAsync().
+    std::once_flag asyncReaderOnce_;
+    std::unique_ptr<AsyncReader> asyncReader_;
+
+    std::unique_ptr<Compaction> compaction_;
+    std::thread compactionThread_;
+    std::mutex compactionMutex_;
+    std::condition_variable compactionCv_;
+    bool compactionScheduled_;
+    bool compactionRunning_;
+    bool shuttingDown_;
+
+    // Shared by tables and logs.
+    std::atomic<uint64_t> nextFileNumber_;
+    // Logs numbered from here on were created by this instance, so all their
+    // records are tagged with their number and they are safe to recycle.
+    uint64_t firstOwnLogNumber_;
+    // Sequence number of the last write visible to readers. Writes of the
+    // group being committed may already sit in the memtable above it.
+    std::atomic<uint64_t> lastSequence_;
+
+    void recoverFromWAL();
+    void loadExistingSSTables();
+    std::filesystem::path logPath(uint64_t number) const;
+    std::filesystem::path recycledLogPath(uint64_t number) const;
+    std::shared_ptr<WAL> newLog(uint64_t number);
+    void retireLog(const std::filesystem::path& path);
+
+    std::shared_ptr<MemTable> newMemTable() const;
+    void makeRoomForWrite();
+    void flushLoop();
+    std::shared_ptr<SSTable> writeLevel0Table(const MemTable& memTable, uint64_t number, uint64_t smallestSnapshot);
+    // Oldest sequence number any reader may still read at. Requires
+    // stateMutex_.
+    uint64_t smallestSnapshot() const;
+
+    void writeInternal(Writer& writer);
+    void syncWal();
+    void syncLoop();
+
+    std::shared_ptr<const TableSet> currentTables() const;
+    std::filesystem::path tablePath(int level, uint64_t number) const;
+
+    void scheduleCompaction();
+    void compactionLoop();
+    bool compactOnce();
+
+public:
+    explicit DBImpl(const std::filesystem::path& path, const Options& options = Options());
+    ~DBImpl() override;
+
+    void remove(const std::string& key) override;
+    void put(const std::string& key, const std::string& value) override;
+    std::optional<std::string> get(const std::string& key) override;
+    std::optional<std::string> get(const ReadOptions& options, const std::string& key) override;
+    std::vector<std::optional<std::string>> multiGet(std::span<const std::string> keys) override;
+    std::vector<std::optional<std::string>> multiGet(const ReadOptions& options, std::span<const std::string> keys) override;
+    std::future<std::optional<std::string>> getAsync(const std::string& key) override;
+    std::future<std::optional<std::string>> getAsync(const ReadOptions& options, const std::string& key) override;
+    void write(const WriteBatch& batch) override;
+    std::unique_ptr<Iterator> newIterator(const ReadOptions& options = ReadOptions()) override;
+    const Snapshot* getSnapshot() override;
+    void releaseSnapshot(const Snapshot* snapshot) override;
+
+    // Waits until every full memtable is flushed and no compaction is
+    // pending or running.
+    void waitForCompaction();
+    Statistics& getStatistics() const;
+    size_t numTablesAtLevel(int level) const;
+};
+
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,319 @@
+#include "DBIterator.hpp"
+#include "version/Version.hpp"
+#include "iterator/MergingIterator.hpp"
+#include "memtable/MemTable.hpp"
+#include <algorithm>
+
+namespace lsmdb {
+
+namespace {
+
+// Concatenates the tables of a level >= 1, which are sorted and disjoint,
+// opening one table at a time.
+class LevelIterator : public InternalIterator {
+private:
+    std::vector<TableFile> files_;
+    bool verifyChecksums_;
+    size_t fileIndex_;
+    std::unique_ptr<InternalIterator> current_;
+
+    void openFile(size_t index) {
+        fileIndex_ = index;
+        current_ = index < files_.size() ? files_[index].table->newIterator(verifyChecksums_) : nullptr;
+    }
+
+    void skipEmptyFilesForward() {
+        while(current_ && !current_->valid()) {
+            openFile(fileIndex_ + 1);
+            if(current_) {
+                current_->seekToFirst();
+            }
+        }
+    }
+
+    void skipEmptyFilesBackward() {
+        while(current_ && !current_->valid()) {
+            if(fileIndex_ == 0) {
+                current_ = nullptr;
+                return;
+            }
+            openFile(fileIndex_ - 1);
+            current_->seekToLast();
+        }
+    }
+
+public:
+    LevelIterator(std::vector<TableFile> files, bool verifyChecksums)
+        : files_(std::move(files))
+        , verifyChecksums_(verifyChecksums)
+        , fileIndex_(0) {
+    }
+
+    bool valid() const override {
+        return current_ && current_->valid();
+    }
+
+    void seekToFirst() override {
+        openFile(0);
+        if(current_) {
+            current_->seekToFirst();
+        }
+        skipEmptyFilesForward();
+    }
+
+    void seekToLast() override {
+        if(files_.empty()) {
+            current_ = nullptr;
+            return;
+        }
+        openFile(files_.size() - 1);
+        current_->seekToLast();
+        skipEmptyFilesBackward();
+    }
+
+    void seek(const std::string& target, uint64_t sequence) override {
+        auto it = std::lower_bound(files_.begin(), files_.end(), target,
+            [](const TableFile& file, const std::string& k) {
+                return file.table->getLargestKey() < k;
+            });
+        openFile(it - files_.begin());
+        if(current_) {
+            current_->seek(target, sequence);
+        }
+        skipEmptyFilesForward();
+    }
+
+    void next() override {
+        current_->next();
+        skipEmptyFilesForward();
+    }
+
+    void prev() override {
+        current_->prev();
+        skipEmptyFilesBackward();
+    }
+
+    std::string_view key() const override {
+        return current_->key();
+    }
+
+    std::string_view value() const override {
+        return current_->value();
+    }
+
+    bool deleted() const override {
+        return current_->deleted();
+    }
+
+    uint64_t sequence() const override {
+        return current_->sequence();
+    }
+};
+
+// Versions newer than sequence_ are invisible. Moving forward, iter_ sits on
+// the newest visible version of the current key and key()/value() read
+// through it. Moving backward, iter_ sits before every
+// version of the current key, which is therefore copied into savedKey_ and
+// savedValue_.
+class DBIterator : public Iterator {
+private:
+    enum class Direction { FORWARD, REVERSE };
+
+    std::vector<std::shared_ptr<const MemTable>> memTables_;
+    std::shared_ptr<const TableSet> tables_;
+    std::unique_ptr<InternalIterator> iter_;
+    ReadOptions options_;
+    uint64_t sequence_;
+    Direction direction_;
+    bool valid_;
+    std::string savedKey_;
+    std::string savedValue_;
+
+    bool belowLowerBound(std::string_view key) const {
+        return options_.lowerBound && key < *options_.lowerBound;
+    }
+
+    bool atOrAboveUpperBound(std::string_view key) const {
+        return options_.upperBound && key >= *options_.upperBound;
+    }
+
+    // Advances to the newest live version of the first key not yet passed.
+    // When skipping, every version of savedKey_ is passed over first.
+    void findNextUserEntry(bool skipping) {
+        while(iter_->valid()) {
+            std::string_view key = iter_->key();
+            if((skipping && key == savedKey_) || iter_->sequence() > sequence_) {
+                iter_->next();
+                continue;
+            }
+            if(atOrAboveUpperBound(key)) {
+                break;
+            }
+            if(iter_->deleted()) {
+                savedKey_.assign(key);
+                skipping = true;
+                iter_->next();
+                continue;
+            }
+            valid_ = true;
+            return;
+        }
+        valid_ = false;
+    }
+
+    // Walks backwards over every version of the previous key, oldest first,
+    // keeping the newest one.
+    void findPrevUserEntry() {
+        bool found = false;
+        while(iter_->valid()) {
+            std::string_view key = iter_->key();
+            if(found && key < savedKey_) {
+                break;
+            }
+            if(belowLowerBound(key)) {
+                break;
+            }
+            if(iter_->sequence() > sequence_) {
+                iter_->prev();
+                continue;
+            }
+            if(iter_->deleted()) {
+                found = false;
+                savedKey_.clear();
+                savedValue_.clear();
+            } else {
+                found = true;
+                savedKey_.assign(key);
+                savedValue_.assign(iter_->value());
+            }
+            iter_->prev();
+        }
+        valid_ = found;
+    }
+
+public:
+    DBIterator(std::vector<std::shared_ptr<const MemTable>> memTables, std::shared_ptr<const TableSet> tables, std::unique_ptr<InternalIterator> iter, const ReadOptions& options, uint64_t sequence)
+        : memTables_(std::move(memTables))
+        , tables_(std::move(tables))
+        , iter_(std::move(iter))
+        , options_(options)
+        , sequence_(sequence)
+        , direction_(Direction::FORWARD)
+        , valid_(false) {
+    }
+
+    bool valid() const override {
+        return valid_;
+    }
+
+    void seekToFirst() override {
+        direction_ = Direction::FORWARD;
+        if(options_.lowerBound) {
+            iter_->seek(*options_.lowerBound);
+        } else {
+            iter_->seekToFirst();
+        }
+        findNextUserEntry(false);
+    }
+
+    void seekToLast() override {
+        direction_ = Direction::REVERSE;
+        if(options_.upperBound) {
+            iter_->seek(*options_.upperBound);
+            if(iter_->valid()) {
+                iter_->prev();
+            } else {
+                iter_->seekToLast();
+            }
+        } else {
+            iter_->seekToLast();
+        }
+        findPrevUserEntry();
+    }
+
+    void seek(const std::string& target) override {
+        direction_ = Direction::FORWARD;
+        if(belowLowerBound(target)) {
+            iter_->seek(*options_.lowerBound, sequence_);
+        } else {
+            iter_->seek(target, sequence_);
+        }
+        findNextUserEntry(false);
+    }
+
+    void next() override {
+        if(direction_ == Direction::REVERSE) {
+            // iter_ is before the current key; bring it back onto it.
+            direction_ = Direction::FORWARD;
+            iter_->seek(savedKey_);
+        } else {
+            savedKey_.assign(iter_->key());
+        }
+        findNextUserEntry(true);
+    }
+
+    void prev() override {
+        if(direction_ == Direction::FORWARD) {
+            // iter_ is on the current key; step back past all its versions.
+            direction_ = Direction::REVERSE;
+            savedKey_.assign(iter_->key());
+            do {
+                iter_->prev();
+            } while(iter_->valid() && iter_->key() >= savedKey_);
+        }
+        findPrevUserEntry();
+    }
+
+    std::string_view key() const override {
+        return direction_ == Direction::FORWARD ? iter_->key() : std::string_view(savedKey_);
+    }
+
+    std::string_view value() const override {
+        return direction_ == Direction::FORWARD ? iter_->value() : std::string_view(savedValue_);
+    }
+};
+
+bool overlapsBounds(const SSTable& table, const ReadOptions& options) {
+    if(options.lowerBound && table.getLargestKey() < *options.lowerBound) {
+        return false;
+    }
+    if(options.upperBound && table.getSmallestKey() >= *options.upperBound) {
+        return false;
+    }
+    return true;
+}
+
+}
+
+std::unique_ptr<Iterator> newDBIterator(std::vector<std::shared_ptr<const MemTable>> memTables, std::shared_ptr<const TableSet> tables, const ReadOptions& options, uint64_t sequence) {
+    // Children go newest first: the memtables, L0 from the latest flush
+    // back, then each deeper level.
+    std::vector<std::unique_ptr<InternalIterator>> children;
+    for(const auto& memTable : memTables) {
+        children.push_back(memTable->newIterator());
+    }
+
+    const auto& level0 = tables->levels[0];
+    for(auto it = level0.rbegin(); it != level0.rend(); ++it) {
+        if(overlapsBounds(*it->table, options)) {
+            children.push_back(it->table->newIterator(options.verifyChecksums));
+        }
+    }
+
+    for(int level = 1; level < TableSet::NUM_LEVELS; level++) {
+        std::vector<TableFile> files;
+        for(const auto& file : tables->levels[level]) {
+            if(overlapsBounds(*file.table, options)) {
+                files.push_back(file);
+            }
+        }
+        if(!files.empty()) {
+            children.push_back(std::make_unique<LevelIterator>(std::move(files), options.verifyChecksums));
+        }
+    }
+
+    auto merged = newMergingIterator(std::move(children));
+    return std::make_unique<DBIterator>(std::move(memTables), std::move(tables), std::move(merged), options, sequence);
+}
+
+}
\ No newline at end of file
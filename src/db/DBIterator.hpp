@@ -0,0 +1,23 @@
+#ifndef LSMDB_DBITERATOR_HPP
+#define LSMDB_DBITERATOR_HPP
+
+#include "Iterator.hpp"
+#include "Options.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lsmdb {
+
+class MemTable;
+struct TableSet;
+
+// Merges the memtables, newest first, with every table of the set, hiding
+// tombstones, shadowed versions and anything written after sequence. All of
+// them are kept alive for the iterator's lifetime.
+std::unique_ptr<Iterator> newDBIterator(std::vector<std::shared_ptr<const MemTable>> memTables, std::shared_ptr<const TableSet> tables, const ReadOptions& options, uint64_t sequence);
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "WriteBatch.hpp"
+#include "WriteBatchInternal.hpp"
+#include "util/Coding.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace lsmdb {
+
+namespace {
+
+// rep_ := count: uint32, then count records of
+//         type: uint8, keySize: uint32, key, [valueSize: uint32, value]
+constexpr size_t HEADER_SIZE = sizeof(uint32_t);
+constexpr uint8_t TYPE_PUT = 1;
+constexpr uint8_t TYPE_DELETE = 2;
+
+void setCount(std::string& rep, uint32_t count) {
+    std::memcpy(&rep[0], &count, sizeof(count));
+}
+
+}
+
+WriteBatch::WriteBatch() {
+    clear();
+}
+
+void WriteBatch::put(const std::string& key, const std::string& value) {
+    setCount(rep_, count() + 1);
+    rep_.push_back(static_cast<char>(TYPE_PUT));
+    putFixed32(rep_, key.size());
+    rep_.append(key);
+    putFixed32(rep_, value.size());
+    rep_.append(value);
+}
+
+void WriteBatch::remove(const std::string& key) {
+    setCount(rep_, count() + 1);
+    rep_.push_back(static_cast<char>(TYPE_DELETE));
+    putFixed32(rep_, key.size());
+    rep_.append(key);
+}
+
+void WriteBatch::append(const WriteBatch& other) {
+    setCount(rep_, count() + other.count());
+    rep_.append(other.rep_, HEADER_SIZE, std::string::npos);
+}
+
+void WriteBatch::clear() {
+    rep_.assign(HEADER_SIZE, '\0');
+}
+
+size_t WriteBatch::count() const {
+    return decodeFixed32(rep_.data());
+}
+
+size_t WriteBatch::approximateSize() const {
+    return rep_.size();
+}
+
+void WriteBatch::iterate(Handler& handler) const {
+    WriteBatchInternal::iterate(rep_, handler);
+}
+
+size_t WriteBatchInternal::count(std::string_view contents) {
+    if(contents.size() < HEADER_SIZE) {
+        throw std::runtime_error("Malformed WriteBatch");
+    }
+    return decodeFixed32(contents.data());
+}
+
+void WriteBatchInternal::iterate(std::string_view contents, WriteBatch::Handler& handler) {
+    size_t expected = count(contents);
+    const char* p = contents.data() + HEADER_SIZE;
+    const char* limit = contents.data() + contents.size();
+
+    auto readSlice = [&](std::string& out) {
+        if(static_cast<size_t>(limit - p) < sizeof(uint32_t)) {
+            throw std::runtime_error("Malformed WriteBatch");
+        }
+        uint32_t size = decodeFixed32(p);
+        p += sizeof(uint32_t);
+        if(static_cast<size_t>(limit - p) < size) {
+            throw std::runtime_error("Malformed WriteBatch");
+        }
+        out.assign(p, size);
+        p += size;
+    };
+
+    std::string key;
+    std::string value;
+    size_t found = 0;
+    while(p < limit) {
+        uint8_t type = static_cast<uint8_t>(*p++);
+        readSlice(key);
+        if(type == TYPE_PUT) {
+            readSlice(value);
+            handler.put(key, value);
+        } else if(type == TYPE_DELETE) {
+            handler.remove(key);
+        } else {
+            throw std::runtime_error("Unknown WriteBatch record type");
+        }
+        found++;
+    }
+
+    if(found != expected) {
+        throw std::runtime_error("WriteBatch has wrong count");
+    }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef LSMDB_WRITEBATCHINTERNAL_HPP
+#define LSMDB_WRITEBATCHINTERNAL_HPP
+
+#include "WriteBatch.hpp"
+
+#include <string>
+#include <string_view>
+
+namespace lsmdb {
+
+// Access to the encoded form of a batch, which is what the WAL stores.
+class WriteBatchInternal {
+public:
+    static const std::string& contents(const WriteBatch& batch) {
+        return batch.rep_;
+    }
+
+    static void setContents(WriteBatch& batch, std::string_view contents) {
+        batch.rep_.assign(contents.data(), contents.size());
+    }
+
+    // Read an encoded batch in place, e.g. straight from a mapped log.
+    static size_t count(std::string_view contents);
+    static void iterate(std::string_view contents, WriteBatch::Handler& handler);
+};
+
+}
+
+#endif
\ No newline at end of file
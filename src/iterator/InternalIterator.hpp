@@ -0,0 +1,39 @@
+#ifndef LSMDB_INTERNALITERATOR_HPP
+#define LSMDB_INTERNALITERATOR_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace lsmdb {
+
+constexpr uint64_t MAX_SEQUENCE_NUMBER = UINT64_MAX;
+
+// Ordered cursor over one source of entries (memtable, table, level).
+// Unlike the public Iterator it also yields tombstones and every version of
+// a key, ordered by key and then by sequence number, newest first. key()
+// and value() stay valid until the iterator is moved.
+class InternalIterator {
+public:
+    virtual ~InternalIterator() = default;
+
+    virtual bool valid() const = 0;
+    virtual void seekToFirst() = 0;
+    virtual void seekToLast() = 0;
+    // Positions at the first entry after (target, sequence) in iteration
+    // order: the newest version of target no newer than sequence, or else
+    // the first entry of a later key.
+    virtual void seek(const std::string& target, uint64_t sequence) = 0;
+    void seek(const std::string& target) { seek(target, MAX_SEQUENCE_NUMBER); }
+    virtual void next() = 0;
+    virtual void prev() = 0;
+
+    virtual std::string_view key() const = 0;
+    virtual std::string_view value() const = 0;
+    virtual bool deleted() const = 0;
+    virtual uint64_t sequence() const = 0;
+};
+
+}
+
+#endif
\ No newline at end of file
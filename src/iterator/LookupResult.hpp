@@ -0,0 +1,29 @@
+#ifndef LSMDB_LOOKUPRESULT_HPP
+#define LSMDB_LOOKUPRESULT_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace lsmdb {
+
+// What one memtable or table knows about a key. A tombstone is as final as
+// a value: a lookup stops at the first source that is not ABSENT, since
+// older sources can only hold versions the tombstone shadows.
+struct LookupResult {
+    enum class State : uint8_t {
+        ABSENT,
+        FOUND,
+        DELETED
+    };
+
+    State state = State::ABSENT;
+    std::string value;
+
+    bool absent() const { return state == State::ABSENT; }
+    bool found() const { return state == State::FOUND; }
+    bool deleted() const { return state == State::DELETED; }
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "MergingIterator.hpp"
+
+namespace lsmdb {
+
+namespace {
+
+class MergingIterator : public InternalIterator {
+private:
+    enum class Direction { FORWARD, REVERSE };
+
+    std::vector<std::unique_ptr<InternalIterator>> children_;
+    InternalIterator* current_;
+    size_t currentIndex_;
+    Direction direction_;
+
+    // Entries are ordered by key, then by sequence number and child index,
+    // newest first. Both children must be valid.
+    bool before(size_t a, size_t b) const {
+        const auto* childA = children_[a].get();
+        const auto* childB = children_[b].get();
+        int cmp = childA->key().compare(childB->key());
+        if(cmp != 0) {
+            return cmp < 0;
+        }
+        if(childA->sequence() != childB->sequence()) {
+            return childA->sequence() > childB->sequence();
+        }
+        return a < b;
+    }
+
+    void findSmallest() {
+        current_ = nullptr;
+        for(size_t i = 0; i < children_.size(); i++) {
+            if(children_[i]->valid() && (!current_ || before(i, currentIndex_))) {
+                current_ = children_[i].get();
+                currentIndex_ = i;
+            }
+        }
+    }
+
+    void findLargest() {
+        current_ = nullptr;
+        for(size_t i = 0; i < children_.size(); i++) {
+            if(children_[i]->valid() && (!current_ || before(currentIndex_, i))) {
+                current_ = children_[i].get();
+                currentIndex_ = i;
+            }
+        }
+    }
+
+public:
+    explicit MergingIterator(std::vector<std::unique_ptr<InternalIterator>> children)
+        : children_(std::move(children))
+        , current_(nullptr)
+        , currentIndex_(0)
+        , direction_(Direction::FORWARD) {
+    }
+
+    bool valid() const override {
+        return current_ != nullptr;
+    }
+
+    void seekToFirst() override {
+        for(auto& child : children_) {
+            child->seekToFirst();
+        }
+        findSmallest();
+        direction_ = Direction::FORWARD;
+    }
+
+    void seekToLast() override {
+        for(auto& child : children_) {
+            child->seekToLast();
+        }
+        findLargest();
+        direction_ = Direction::REVERSE;
+    }
+
+    void seek(const std::string& target, uint64_t sequence) override {
+        for(auto& child : children_) {
+            child->seek(target, sequence);
+        }
+        findSmallest();
+        direction_ = Direction::FORWARD;
+    }
+
+    void next() override {
+        // After moving backwards the other children sit before the current
+        // entry; move each to the first entry after it.
+        if(direction_ != Direction::FORWARD) {
+            std::string key(current_->key());
+            uint64_t sequence = current_->sequence();
+            for(size_t i = 0; i < children_.size(); i++) {
+                if(i == currentIndex_) {
+                    continue;
+                }
+                auto* child = children_[i].get();
+                child->seek(key, sequence);
+                if(child->valid() && before(i, currentIndex_)) {
+                    child->next();
+                }
+            }
+            direction_ = Direction::FORWARD;
+        }
+
+        current_->next();
+        findSmallest();
+    }
+
+    void prev() override {
+        // After moving forwards the other children sit after the current
+        // entry; move each to the last entry before it.
+        if(direction_ != Direction::REVERSE) {
+            std::string key(current_->key());
+            uint64_t sequence = current_->sequence();
+            for(size_t i = 0; i < children_.size(); i++) {
+                if(i == currentIndex_) {
+                    continue;
+                }
+                auto* child = children_[i].get();
+                child->seek(key, sequence);
+                if(!child->valid()) {
+                    child->seekToLast();
+                } else if(!before(i, currentIndex_)) {
+                    child->prev();
+                }
+            }
+            direction_ = Direction::REVERSE;
+        }
+
+        current_->prev();
+        findLargest();
+    }
+
+    std::string_view key() const override {
+        return current_->key();
+    }
+
+    std::string_view value() const override {
+        return current_->value();
+    }
+
+    bool deleted() const override {
+        return current_->deleted();
+    }
+
+    uint64_t sequence() const override {
+        return current_->sequence();
+    }
+};
+
+}
+
+std::unique_ptr<InternalIterator> newMergingIterator(std::vector<std::unique_ptr<InternalIterator>> children) {
+    return std::make_unique<MergingIterator>(std::move(children));
+}
+
+}
\ No newline at end of file
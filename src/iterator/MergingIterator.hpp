@@ -0,0 +1,18 @@
+#ifndef LSMDB_MERGINGITERATOR_HPP
+#define LSMDB_MERGINGITERATOR_HPP
+
+#include "InternalIterator.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace lsmdb {
+
+// Merges sorted children into one sorted stream. Children are passed newest
+// first; entries with equal keys are all yielded, the newest first when
+// moving forward and last when moving backward.
+std::unique_ptr<InternalIterator> newMergingIterator(std::vector<std::unique_ptr<InternalIterator>> children);
+
+}
+
+#endif
\ No newline at end of file
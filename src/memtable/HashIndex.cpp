@@ -0,0 +1,78 @@
+#include "HashIndex.hpp"
+#include "arena/Arena.hpp"
+
+#include <functional>
+#include <new>
+
+namespace lsmdb {
+
+HashIndex::Entry::Entry(uint64_t h, const SkipList::Node* n, Entry* e)
+    : hash(h)
+    , node(n)
+    , next(e) {
+}
+
+HashIndex::HashIndex(Arena* arena, size_t buckets)
+    : arena_(arena) {
+    size_t count = 1;
+    while(count < buckets) {
+        count <<= 1;
+    }
+    mask_ = count - 1;
+    buckets_ = reinterpret_cast<std::atomic<Entry*>*>(arena_->allocateAligned(sizeof(std::atomic<Entry*>) * count));
+    for(size_t i = 0; i < count; i++) {
+        new (&buckets_[i]) std::atomic<Entry*>(nullptr);
+    }
+}
+
+uint64_t HashIndex::hashOf(std::string_view key) {
+    return std::hash<std::string_view>()(key);
+}
+
+// Searches a chain from entry up to (not including) end.
+HashIndex::Entry* HashIndex::findIn(Entry* entry, Entry* end, uint64_t hash, std::string_view key) {
+    for(; entry != end; entry = entry->next) {
+        if(entry->hash == hash && entry->node.load(std::memory_order_acquire)->key() == key) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+void HashIndex::raise(Entry* entry, const SkipList::Node* node) {
+    const SkipList::Node* current = entry->node.load(std::memory_order_acquire);
+    while(current->sequence < node->sequence) {
+        if(entry->node.compare_exchange_weak(current, node, std::memory_order_release, std::memory_order_acquire)) {
+            return;
+        }
+    }
+}
+
+void HashIndex::insert(const SkipList::Node* node) {
+    uint64_t hash = hashOf(node->key());
+    std::atomic<Entry*>& bucket = buckets_[hash & mask_];
+
+    Entry* head = bucket.load(std::memory_order_acquire);
+    if(Entry* entry = findIn(head, nullptr, hash, node->key())) {
+        raise(entry, node);
+        return;
+    }
+
+    Entry* entry = new (arena_->allocateAligned(sizeof(Entry))) Entry(hash, node, head);
+    while(!bucket.compare_exchange_weak(entry->next, entry, std::memory_order_release, std::memory_order_acquire)) {
+        // Only entries pushed since the last attempt can hold the key.
+        if(Entry* existing = findIn(entry->next, head, hash, node->key())) {
+            raise(existing, node);
+            return;
+        }
+        head = entry->next;
+    }
+}
+
+const SkipList::Node* HashIndex::find(std::string_view key) const {
+    uint64_t hash = hashOf(key);
+    Entry* entry = findIn(buckets_[hash & mask_].load(std::memory_order_acquire), nullptr, hash, key);
+    return entry ? entry->node.load(std::memory_order_acquire) : nullptr;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef LSMDB_HASHINDEX_HPP
+#define LSMDB_HASHINDEX_HPP
+
+#include "../skiplist/SkipList.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace lsmdb {
+
+class Arena;
+
+// Lock-free map from each key of a skiplist to the node of its newest
+// version, so point lookups skip the skiplist descent. Entries live in the
+// arena and are never removed; the bucket count is fixed when the index is
+// created.
+class HashIndex {
+private:
+    struct Entry {
+        const uint64_t hash;
+        std::atomic<const SkipList::Node*> node;
+        Entry* next;
+
+        Entry(uint64_t h, const SkipList::Node* n, Entry* e);
+    };
+
+    Arena* arena_;
+    size_t mask_;
+    std::atomic<Entry*>* buckets_;
+
+    static uint64_t hashOf(std::string_view key);
+    static Entry* findIn(Entry* entry, Entry* end, uint64_t hash, std::string_view key);
+    static void raise(Entry* entry, const SkipList::Node* node);
+
+public:
+    // Rounds buckets up to a power of two.
+    HashIndex(Arena* arena, size_t buckets);
+
+    HashIndex(const HashIndex&) = delete;
+    HashIndex& operator=(const HashIndex&) = delete;
+
+    // Safe to call from any number of threads at once; the entry for the
+    // node's key ends up with the version of highest sequence.
+    void insert(const SkipList::Node* node);
+
+    // Newest version of key inserted so far, or nullptr.
+    const SkipList::Node* find(std::string_view key) const;
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -1,41 +1,106 @@
-#include "MemTable.hpp"
-
-namespace lsmdb {
-
-MemTable::MemTable() 
-    : skiplist_(std::make_unique<SkipList>())
-    , size_(0) {
-}
-
-MemTable::~MemTable() = default;
-
-void MemTable::put(const std::string& key, const std::string& value) {
-    skiplist_->put(key, value);
-    size_.store(skiplist_->estimateMemoryUsage(), std::memory_order_relaxed);
-}
-
-std::optional<std::string> MemTable::get(const std::string& key) const {
-    return skiplist_->get(key);
-}
-
-void MemTable::remove(const std::string& key) {
-    skiplist_->remove(key);
-    size_.store(skiplist_->estimateMemoryUsage(), std::memory_order_relaxed);
-}
-
-size_t MemTable::getSize() const {
-    return size_.load(std::memory_order_relaxed);
-}
-
-bool MemTable::shouldFlush(size_t threshold) const {
-    return getSize() >= threshold;
-}
-
-bool MemTable::isDeleted(const std::string& key) const {
-    return skiplist_->isDeleted(key);
-}
-
-SkipList* MemTable::getSkipList() const {
-    return skiplist_.get();
-}
+#include "MemTable.hpp"
+#include "iterator/InternalIterator.hpp"
+
+namespace lsmdb {
+
+namespace {
+
+class MemTableIterator : public InternalIterator {
+private:
+    SkipList::Iterator iter_;
+
+public:
+    explicit MemTableIterator(const SkipList* skiplist) : iter_(skiplist) {}
+
+    bool valid() const override { return iter_.valid(); }
+    void seekToFirst() override { iter_.seekToFirst(); }
+    void seekToLast() override { iter_.seekToLast(); }
+    void seek(const std::string& target, uint64_t sequence) override { iter_.seek(target, sequence); }
+    void next() override { iter_.next(); }
+    void prev() override { iter_.prev(); }
+
+    std::string_view key() const override { return iter_.node()->key(); }
+    std::string_view value() const override { return iter_.node()->value(); }
+    bool deleted() const override { return iter_.node()->deleted(); }
+    uint64_t sequence() const override { return iter_.node()->sequence; }
+};
+
+}
+
+MemTable::MemTable(size_t hashIndexBuckets) 
+    : skiplist_(std::make_unique<SkipList>(&arena_)) {
+    if(hashIndexBuckets > 0) {
+        index_ = std::make_unique<HashIndex>(&arena_, hashIndexBuckets);
+    }
+}
+
+MemTable::~MemTable() = default;
+
+void MemTable::put(const std::string& key, const std::string& value, uint64_t sequence) {
+    const SkipList::Node* node = skiplist_->insert(key, sequence, value, false);
+    if(index_) {
+        index_->insert(node);
+    }
+}
+
+// A version in the skiplist is in the index too once its write is visible,
+// so the index answers unless its newest version is too new for sequence.
+const SkipList::Node* MemTable::findNode(const std::string& key, uint64_t sequence) const {
+    if(index_) {
+        const SkipList::Node* node = index_->find(key);
+        if(!node || node->sequence <= sequence) {
+            return node;
+        }
+    }
+    return skiplist_->find(key, sequence);
+}
+
+LookupResult MemTable::lookup(const std::string& key, uint64_t sequence) const {
+    LookupResult result;
+    const SkipList::Node* node = findNode(key, sequence);
+    if(node && node->deleted()) {
+        result.state = LookupResult::State::DELETED;
+    } else if(node) {
+        result.state = LookupResult::State::FOUND;
+        result.value.assign(node->value());
+    }
+    return result;
+}
+
+std::optional<std::string> MemTable::get(const std::string& key, uint64_t sequence) const {
+    LookupResult result = lookup(key, sequence);
+    if(result.found()) {
+        return std::move(result.value);
+    }
+    return std::nullopt;
+}
+
+void MemTable::remove(const std::string& key, uint64_t sequence) {
+    const SkipList::Node* node = skiplist_->insert(key, sequence, "", true);
+    if(index_) {
+        index_->insert(node);
+    }
+}
+
+size_t MemTable::getSize() const {
+    return skiplist_->estimateMemoryUsage();
+}
+
+bool MemTable::shouldFlush(size_t threshold) const {
+    return getSize() >= threshold;
+}
+
+bool MemTable::isDeleted(const std::string& key, uint64_t sequence) const {
+    const SkipList::Node* node = findNode(key, sequence);
+    return node && node->deleted();
+}
+
+SkipList* MemTable::getSkipList() const {
+    return skiplist_.get();
+}
+
+std::unique_ptr<InternalIterator> MemTable::newIterator() const {
+    return std::make_unique<MemTableIterator>(skiplist_.get());
+}
+
 }
\ No newline at end of file
@@ -1,40 +1,60 @@
-#ifndef LSMDB_MEMTABLE_HPP
-#define LSMDB_MEMTABLE_HPP
-
-#include "../skiplist/SkipList.hpp"
-
-#include <memory>
-#include <string>
-#include <optional>
-#include <atomic>
-
-namespace lsmdb {
-
-class SkipList;
-
-class MemTable {
-private:
-    std::unique_ptr<SkipList> skiplist_;
-    std::atomic<size_t> size_;
-    
-public:
-    MemTable();
-    ~MemTable();
-    
-    MemTable(const MemTable&) = delete;
-    MemTable& operator=(const MemTable&) = delete;
-
-    void remove(const std::string& key);    
-    void put(const std::string& key, const std::string& value);
-    std::optional<std::string> get(const std::string& key) const;
-
-    size_t getSize() const;
-    bool shouldFlush(size_t threshold) const;
-    bool isDeleted(const std::string& key) const;
-
-    SkipList* getSkipList() const;
-};
-
-}
-
+#ifndef LSMDB_MEMTABLE_HPP
+#define LSMDB_MEMTABLE_HPP
+
+#include "../skiplist/SkipList.hpp"
+#include "../arena/Arena.hpp"
+#include "HashIndex.hpp"
+#include "../iterator/LookupResult.hpp"
+
+#include <memory>
+#include <string>
+#include <optional>
+#include <atomic>
+
+namespace lsmdb {
+
+class SkipList;
+class InternalIterator;
+
+class MemTable {
+private:
+    // Owns every node and key/value byte of the skiplist; dropping the
+    // memtable frees them all at once.
+    Arena arena_;
+    std::unique_ptr<SkipList> skiplist_;
+    // Newest version of each key, when enabled.
+    std::unique_ptr<HashIndex> index_;
+
+    const SkipList::Node* findNode(const std::string& key, uint64_t sequence) const;
+    
+public:
+    // A hash index of hashIndexBuckets buckets, taken from the arena, is
+    // kept next to the skiplist when hashIndexBuckets is not 0.
+    explicit MemTable(size_t hashIndexBuckets = 0);
+    ~MemTable();
+    
+    MemTable(const MemTable&) = delete;
+    MemTable& operator=(const MemTable&) = delete;
+
+    // Writes may come from several threads at once; every write carries a
+    // sequence number unique within the memtable, and the highest one wins.
+    void remove(const std::string& key, uint64_t sequence);    
+    void put(const std::string& key, const std::string& value, uint64_t sequence);
+    // Reads see the newest version no newer than sequence.
+    LookupResult lookup(const std::string& key, uint64_t sequence = SkipList::MAX_SEQUENCE) const;
+    std::optional<std::string> get(const std::string& key, uint64_t sequence = SkipList::MAX_SEQUENCE) const;
+
+    size_t getSize() const;
+    bool shouldFlush(size_t threshold) const;
+    bool isDeleted(const std::string& key, uint64_t sequence = SkipList::MAX_SEQUENCE) const;
+
+    SkipList* getSkipList() const;
+
+    // Yields every version of each key, tombstones included. The iterator
+    // must not outlive the memtable.
+    std::unique_ptr<InternalIterator> newIterator() const;
+};
+
+}
+
 #endif
\ No newline at end of file
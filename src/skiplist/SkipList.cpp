@@ -1,149 +1,234 @@
-#include "SkipList.hpp"
-
-namespace lsmdb {
-
-thread_local std::mt19937 SkipList::rng_(std::random_device{}());
-
-SkipList::Node::Node(std::string k, std::string v, int h, bool del)
-    : key(std::move(k))
-    , value(std::move(v))
-    , deleted(del)
-    , height(h) {
-    for(int i = 0; i < h; i++) {
-        forward[i].store(nullptr, std::memory_order_relaxed);
-    }
-}
-    
-SkipList::SkipList() : maxHeight_(1) {
-    head_ = newNode("", "", MAX_HEIGHT);
-}
-
-SkipList::~SkipList() {
-    Node* current = head_;
-    while(current) {
-        Node* next = current->forward[0].load(std::memory_order_relaxed);
-        delete current;
-        current = next;
-    }
-}
-
-SkipList::Node* SkipList::newNode(std::string key, std::string value, int height, bool deleted) {
-    size_t nodeSize = sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1);
-    void* mem = ::operator new(nodeSize);
-    return new (mem) Node(std::move(key), std::move(value), height, deleted);
-}
-
-int SkipList::randomHeight() {
-    int height = 1;
-    std::uniform_real_distribution<double> dist(0.0, 1.0);
-    while(height < MAX_HEIGHT && dist(rng_) < PROBABILITY) {
-        height++;
-    }
-    return height;
-}
-
-bool SkipList::isDeleted(const std::string& key) const {
-    Node* node = findGreaterOrEqual(key, nullptr);
-    return node && node->key == key && node->deleted;
-}
-
-SkipList::Node* SkipList::findGreaterOrEqual(const std::string& key, Node** previous) const {
-    Node* current = head_;
-    int level = maxHeight_.load(std::memory_order_acquire) - 1;
-
-    while(level >= 0) {
-        Node* next = current->forward[level].load(std::memory_order_acquire);
-
-        if(next && next->key < key) {
-            current = next;
-        } else {
-            if(previous) {
-                previous[level] = current;
-            }
-            level--;
-        }
-    }
-
-    return current->forward[0].load(std::memory_order_acquire);
-}
-
-void SkipList::put(const std::string& key, const std::string& value) {
-    Node* previous[MAX_HEIGHT];
-    Node* current = findGreaterOrEqual(key, previous);
-
-    if(current && current->key == key) {
-        current->value = value;
-        current->deleted = false;
-        return;
-    }
-
-    int height = randomHeight();
-    int currentMaxHeight = maxHeight_.load(std::memory_order_relaxed);
-
-    if(height > currentMaxHeight) {
-        for(int i = currentMaxHeight; i < height; i++) {
-            previous[i] = head_;
-        }
-        maxHeight_.store(height, std::memory_order_release);
-    }
-
-    Node* node = newNode(key, value, height);
-
-    for(int level = 0; level < height; level++) {
-        Node* next = previous[level]->forward[level].load(std::memory_order_relaxed);
-        node->forward[level].store(next, std::memory_order_relaxed);
-        previous[level]->forward[level].store(node, std::memory_order_release);
-    }
-}
-
-std::optional<std::string> SkipList::get(const std::string& key) const {
-    Node* node = findGreaterOrEqual(key, nullptr);
-
-    if(node && node->key == key && !node->deleted) {
-        return node->value;
-    }
-    return std::nullopt;
-}
-
-void SkipList::remove(const std::string& key) {
-    Node* previous[MAX_HEIGHT];
-    Node* current = findGreaterOrEqual(key, previous);
-
-    if(current && current->key == key) {
-        current->deleted = true;
-    } else {
-        int height = randomHeight();
-        int currentMaxHeight = maxHeight_.load(std::memory_order_relaxed);
-
-        if(height > currentMaxHeight) {
-            for(int i = currentMaxHeight; i < height; i++) {
-                previous[i] = head_;
-            }
-            maxHeight_.store(height, std::memory_order_release);
-        }
-
-        Node* node = newNode(key, "", height, true);
-
-        for(int level = 0; level < height; level++) {
-            Node* next = previous[level]->forward[level].load(std::memory_order_relaxed);
-            node->forward[level].store(next, std::memory_order_relaxed);
-            previous[level]->forward[level].store(node, std::memory_order_release);
-        }
-
-    }
-}
-
-size_t SkipList::estimateMemoryUsage() const {
-    size_t total = sizeof(SkipList);
-    Node* current = head_;
-
-    while(current) {
-        total += sizeof(Node) + sizeof(std::atomic<Node*>) * (current->height - 1);
-        total += current->key.capacity() + current->value.capacity();
-        current = current->forward[0].load(std::memory_order_relaxed);
-    }
-    
-    return total;
-}
-
+#include "SkipList.hpp"
+#include "arena/Arena.hpp"
+#include "util/Coding.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace lsmdb {
+
+thread_local std::mt19937 SkipList::rng_(std::random_device{}());
+
+SkipList::Node::Node(const char* e, uint64_t p, uint64_t seq, int h)
+    : entry(e)
+    , prefix(p)
+    , sequence(seq)
+    , height(h) {
+    for(int i = 0; i < h; i++) {
+        forward[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+std::string_view SkipList::Node::key() const {
+    return std::string_view(entry + sizeof(uint32_t), decodeFixed32(entry));
+}
+
+std::string_view SkipList::Node::value() const {
+    const char* p = entry + sizeof(uint32_t) + decodeFixed32(entry) + 1;
+    return std::string_view(p + sizeof(uint32_t), decodeFixed32(p));
+}
+
+bool SkipList::Node::deleted() const {
+    return entry[sizeof(uint32_t) + decodeFixed32(entry)] != 0;
+}
+    
+SkipList::SkipList(Arena* arena) 
+    : arena_(arena)
+    , maxHeight_(1) {
+    head_ = newNode("", 0, "", false, MAX_HEIGHT);
+}
+
+SkipList::~SkipList() = default;
+
+SkipList::Node* SkipList::newNode(std::string_view key, uint64_t sequence, std::string_view value, bool deleted, int height) {
+    // The entry follows the node in the same allocation, so a search
+    // touches one cache region per node it compares against.
+    size_t nodeSize = sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1);
+    uint32_t keySize = key.size();
+    uint32_t valueSize = value.size();
+    char* mem = arena_->allocateAligned(nodeSize + 2 * sizeof(uint32_t) + 1 + keySize + valueSize);
+
+    char* p = mem + nodeSize;
+    std::memcpy(p, &keySize, sizeof(keySize));
+    p += sizeof(keySize);
+    std::memcpy(p, key.data(), keySize);
+    p += keySize;
+    *p++ = deleted ? 1 : 0;
+    std::memcpy(p, &valueSize, sizeof(valueSize));
+    p += sizeof(valueSize);
+    std::memcpy(p, value.data(), valueSize);
+
+    return new (mem) Node(mem + nodeSize, prefixOf(key), sequence, height);
+}
+
+int SkipList::randomHeight() {
+    int height = 1;
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    while(height < MAX_HEIGHT && dist(rng_) < PROBABILITY) {
+        height++;
+    }
+    return height;
+}
+
+uint64_t SkipList::prefixOf(std::string_view key) {
+    uint64_t prefix = 0;
+    std::memcpy(&prefix, key.data(), std::min(key.size(), sizeof(prefix)));
+    if constexpr(std::endian::native == std::endian::little) {
+        prefix = __builtin_bswap64(prefix);
+    }
+    return prefix;
+}
+
+bool SkipList::lessThan(const Node* node, std::string_view key, uint64_t prefix, uint64_t sequence) {
+    // Unequal prefixes decide on their own; equal ones may still come from
+    // different keys, such as "a" and "a\0".
+    if(node->prefix != prefix) {
+        return node->prefix < prefix;
+    }
+    int cmp = node->key().compare(key);
+    return cmp < 0 || (cmp == 0 && node->sequence > sequence);
+}
+
+void SkipList::findSpliceForLevel(std::string_view key, uint64_t prefix, uint64_t sequence, Node* before, int level, Node** prev, Node** next) const {
+    while(true) {
+        Node* after = before->forward[level].load(std::memory_order_acquire);
+        if(after && lessThan(after, key, prefix, sequence)) {
+            before = after;
+        } else {
+            *prev = before;
+            *next = after;
+            return;
+        }
+    }
+}
+
+SkipList::Node* SkipList::findGreaterOrEqual(std::string_view key, uint64_t sequence) const {
+    uint64_t prefix = prefixOf(key);
+    Node* current = head_;
+    int level = maxHeight_.load(std::memory_order_acquire) - 1;
+
+    while(level >= 0) {
+        Node* next = current->forward[level].load(std::memory_order_acquire);
+
+        if(next && lessThan(next, key, prefix, sequence)) {
+            current = next;
+        } else {
+            level--;
+        }
+    }
+
+    return current->forward[0].load(std::memory_order_acquire);
+}
+
+SkipList::Node* SkipList::findLessThan(std::string_view key, uint64_t sequence) const {
+    uint64_t prefix = prefixOf(key);
+    Node* current = head_;
+    int level = maxHeight_.load(std::memory_order_acquire) - 1;
+
+    while(level >= 0) {
+        Node* next = current->forward[level].load(std::memory_order_acquire);
+
+        if(next && lessThan(next, key, prefix, sequence)) {
+            current = next;
+        } else {
+            level--;
+        }
+    }
+
+    return current == head_ ? nullptr : current;
+}
+
+SkipList::Node* SkipList::findLast() const {
+    Node* current = head_;
+    int level = maxHeight_.load(std::memory_order_acquire) - 1;
+
+    while(level >= 0) {
+        Node* next = current->forward[level].load(std::memory_order_acquire);
+
+        if(next) {
+            current = next;
+        } else {
+            level--;
+        }
+    }
+
+    return current == head_ ? nullptr : current;
+}
+
+SkipList::Iterator::Iterator(const SkipList* list) 
+    : list_(list)
+    , node_(nullptr) {
+}
+
+void SkipList::Iterator::seek(std::string_view target, uint64_t sequence) {
+    node_ = list_->findGreaterOrEqual(target, sequence);
+}
+
+void SkipList::Iterator::seekToFirst() {
+    node_ = list_->head_->forward[0].load(std::memory_order_acquire);
+}
+
+void SkipList::Iterator::seekToLast() {
+    node_ = list_->findLast();
+}
+
+void SkipList::Iterator::next() {
+    node_ = node_->forward[0].load(std::memory_order_acquire);
+}
+
+void SkipList::Iterator::prev() {
+    node_ = list_->findLessThan(node_->key(), node_->sequence);
+}
+
+const SkipList::Node* SkipList::insert(std::string_view key, uint64_t sequence, std::string_view value, bool deleted) {
+    int height = randomHeight();
+    Node* node = newNode(key, sequence, value, deleted, height);
+    uint64_t prefix = node->prefix;
+
+    int currentMaxHeight = maxHeight_.load(std::memory_order_relaxed);
+    while(height > currentMaxHeight) {
+        if(maxHeight_.compare_exchange_weak(currentMaxHeight, height, std::memory_order_relaxed)) {
+            currentMaxHeight = height;
+            break;
+        }
+    }
+
+    // Find where the node goes at every level, top down, each level's search
+    // starting from the node found above it.
+    Node* previous[MAX_HEIGHT];
+    Node* next[MAX_HEIGHT];
+    Node* before = head_;
+    for(int level = currentMaxHeight - 1; level >= 0; level--) {
+        findSpliceForLevel(key, prefix, sequence, before, level, &previous[level], &next[level]);
+        before = previous[level];
+    }
+
+    // Link bottom up so a node reachable at some level is always reachable
+    // at every level below it. A failed CAS means another writer linked a
+    // node at that spot; the splice is recomputed from the same predecessor,
+    // which is still before the new node.
+    for(int level = 0; level < height; level++) {
+        while(true) {
+            node->forward[level].store(next[level], std::memory_order_relaxed);
+            if(previous[level]->forward[level].compare_exchange_strong(next[level], node, std::memory_order_release, std::memory_order_relaxed)) {
+                break;
+            }
+            findSpliceForLevel(key, prefix, sequence, previous[level], level, &previous[level], &next[level]);
+        }
+    }
+    return node;
+}
+
+const SkipList::Node* SkipList::find(std::string_view key, uint64_t sequence) const {
+    Node* node = findGreaterOrEqual(key, sequence);
+    if(node && node->key() == key) {
+        return node;
+    }
+    return nullptr;
+}
+
+size_t SkipList::estimateMemoryUsage() const {
+    return arena_->memoryUsage();
+}
+
 }
\ No newline at end of file
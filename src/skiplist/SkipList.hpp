@@ -1,54 +1,104 @@
-#ifndef LSMDB_SKIPLIST_HPP
-#define LSMDB_SKIPLIST_HPP
-
-#include <string>
-#include <atomic>
-#include <random>
-#include <optional>
-
-namespace lsmdb {
-
-class SkipList {
-public:
-    struct Node {
-        const std::string key;
-        std::string value;
-        bool deleted;
-        const int height;
-        std::atomic<Node*> forward[1];
-
-        Node(std::string k, std::string v, int h, bool del = false);
-    };
-
-private:
-    static constexpr int MAX_HEIGHT = 12;
-    static constexpr double PROBABILITY = 0.25;
-
-    Node* head_;
-    std::atomic<int> maxHeight_;
-    thread_local static std::mt19937 rng_;
-
-    Node* newNode(std::string key, std::string value, int height, bool deleted = false);
-    Node* findGreaterOrEqual(const std::string& key, Node** prev) const; 
-    int randomHeight();
-
-public:
-    SkipList();
-    ~SkipList();
-
-    SkipList(const SkipList&) = delete;
-    SkipList& operator=(const SkipList&) = delete;
-
-    void remove(const std::string& key);
-    void put(const std::string& key, const std::string& value);
-    std::optional<std::string> get(const std::string& key) const;
-    bool isDeleted(const std::string& key) const;
-
-    size_t estimateMemoryUsage() const;
-    
-    Node* getHead() const { return head_; }
-};
-
-}
-
+#ifndef LSMDB_SKIPLIST_HPP
+#define LSMDB_SKIPLIST_HPP
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <optional>
+
+namespace lsmdb {
+
+class Arena;
+
+// Multi-writer, lock-free skiplist. Nodes are never modified once linked:
+// every write inserts a new version ordered by key ascending, then by
+// sequence number descending, so the newest version of a key comes first.
+// Readers never block and never see a half-written node.
+class SkipList {
+public:
+    static constexpr uint64_t MAX_SEQUENCE = UINT64_MAX;
+
+    // Nodes live in the arena with their entry right behind them, laid out
+    // as [u32 key size][key][u8 deleted][u32 value size][value]. The first
+    // bytes of the key are also kept in the node as a big-endian integer,
+    // so most comparisons never touch the entry.
+    struct Node {
+        const char* const entry;
+        const uint64_t prefix;
+        const uint64_t sequence;
+        const int height;
+        std::atomic<Node*> forward[1];
+
+        Node(const char* e, uint64_t p, uint64_t seq, int h);
+
+        std::string_view key() const;
+        std::string_view value() const;
+        bool deleted() const;
+    };
+
+private:
+    static constexpr int MAX_HEIGHT = 12;
+    static constexpr double PROBABILITY = 0.25;
+
+    Arena* arena_;
+    Node* head_;
+    std::atomic<int> maxHeight_;
+    thread_local static std::mt19937 rng_;
+
+    Node* newNode(std::string_view key, uint64_t sequence, std::string_view value, bool deleted, int height);
+    // Leading bytes of key, zero-padded, ordered like the keys they start.
+    static uint64_t prefixOf(std::string_view key);
+    static bool lessThan(const Node* node, std::string_view key, uint64_t prefix, uint64_t sequence);
+    void findSpliceForLevel(std::string_view key, uint64_t prefix, uint64_t sequence, Node* before, int level, Node** prev, Node** next) const;
+    Node* findGreaterOrEqual(std::string_view key, uint64_t sequence) const; 
+    Node* findLessThan(std::string_view key, uint64_t sequence) const;
+    Node* findLast() const;
+    int randomHeight();
+
+public:
+    // Walks every version in order. Moving backwards costs a search from the
+    // head, since nodes only link forward.
+    class Iterator {
+    private:
+        const SkipList* list_;
+        Node* node_;
+
+    public:
+        explicit Iterator(const SkipList* list);
+
+        bool valid() const { return node_ != nullptr; }
+        const Node* node() const { return node_; }
+
+        // Positions at the first version at or after (target, sequence); the
+        // default lands on the newest version of target.
+        void seek(std::string_view target, uint64_t sequence = MAX_SEQUENCE);
+        void seekToFirst();
+        void seekToLast();
+        void next();
+        void prev();
+    };
+
+    // The arena must be safe for concurrent allocation when several threads
+    // insert at once.
+    explicit SkipList(Arena* arena);
+    ~SkipList();
+
+    SkipList(const SkipList&) = delete;
+    SkipList& operator=(const SkipList&) = delete;
+
+    // Safe to call from any number of threads at once. Each (key, sequence)
+    // pair must be unique. Returns the new node.
+    const Node* insert(std::string_view key, uint64_t sequence, std::string_view value, bool deleted);
+
+    // Newest version of key with a sequence number <= sequence, or nullptr.
+    const Node* find(std::string_view key, uint64_t sequence = MAX_SEQUENCE) const;
+
+    // Bytes allocated from the arena, which is exact and O(1) to read.
+    size_t estimateMemoryUsage() const;
+};
+
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,335 @@
+#include "AsyncReader.hpp"
+#include "RandomAccessFile.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define LSMDB_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace lsmdb {
+
+namespace {
+
+// Set on reader threads, whose callbacks may read without waiting for a
+// slot: the slot they wait for could only be freed by their own thread.
+thread_local const AsyncReader* currentReader = nullptr;
+
+}
+
+#ifdef LSMDB_HAVE_IO_URING
+
+// The submission and completion queues shared with the kernel. There is a
+// single submitter at a time (under the reader's mutex) and a single
+// consumer, the completion thread.
+struct AsyncReader::Ring {
+    int fd = -1;
+    void* sqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    void* cqRing = MAP_FAILED;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    ~Ring() {
+        if(sqes != MAP_FAILED) {
+            ::munmap(sqes, sqesSize);
+        }
+        if(cqRing != MAP_FAILED && cqRing != sqRing) {
+            ::munmap(cqRing, cqRingSize);
+        }
+        if(sqRing != MAP_FAILED) {
+            ::munmap(sqRing, sqRingSize);
+        }
+        if(fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    // Returns nullptr where io_uring is missing, disabled, or too old to
+    // have IORING_OP_READ (which came with IORING_FEAT_RW_CUR_POS).
+    static std::unique_ptr<Ring> create(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if(fd < 0) {
+            return nullptr;
+        }
+        auto ring = std::make_unique<Ring>();
+        ring->fd = fd;
+        if(!(params.features & IORING_FEAT_RW_CUR_POS)) {
+            return nullptr;
+        }
+
+        ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if(single) {
+            ring->sqRingSize = ring->cqRingSize = std::max(ring->sqRingSize, ring->cqRingSize);
+        }
+        ring->sqRing = ::mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if(ring->sqRing == MAP_FAILED) {
+            return nullptr;
+        }
+        if(single) {
+            ring->cqRing = ring->sqRing;
+        } else {
+            ring->cqRing = ::mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if(ring->cqRing == MAP_FAILED) {
+                return nullptr;
+            }
+        }
+        ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if(sqes == MAP_FAILED) {
+            return nullptr;
+        }
+        ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<char*>(ring->sqRing);
+        auto* cq = static_cast<char*>(ring->cqRing);
+        ring->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        ring->sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        ring->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        ring->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        ring->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        ring->cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return ring;
+    }
+
+    // Queues one entry and hands it to the kernel; user data 0 marks a
+    // wake-up.
+    void push(uint8_t opcode, int file, uint64_t offset, void* buffer, uint32_t length, uint64_t userData) {
+        unsigned tail = *sqTail;
+        unsigned index = tail & sqMask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = opcode;
+        sqe.fd = file;
+        sqe.off = offset;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = length;
+        sqe.user_data = userData;
+        sqArray[index] = index;
+        std::atomic_ref<unsigned>(*sqTail).store(tail + 1, std::memory_order_release);
+
+        for(;;) {
+            int r = static_cast<int>(::syscall(__NR_io_uring_enter, fd, 1, 0, 0, nullptr, 0));
+            if(r >= 0) {
+                return;
+            }
+            if(errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                throw std::runtime_error("Failed to submit SSTable read");
+            }
+        }
+    }
+
+    void waitForCompletion() const {
+        ::syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+};
+
+#else
+
+struct AsyncReader::Ring {
+    static std::unique_ptr<Ring> create(unsigned) {
+        return nullptr;
+    }
+};
+
+#endif
+
+AsyncReader::AsyncReader(size_t queueDepth, size_t fallbackThreads)
+    : queueDepth_(std::max<size_t>(queueDepth, 1))
+    , inFlight_(0)
+    , stopping_(false) {
+    // Reads continued from callbacks may briefly exceed queueDepth, so the
+    // kernel's completion queue (twice the submission queue) has room.
+    ring_ = Ring::create(static_cast<unsigned>(queueDepth_ + 1));
+    if(ring_) {
+        threads_.emplace_back(&AsyncReader::completionLoop, this);
+        return;
+    }
+    size_t count = std::max<size_t>(fallbackThreads, 1);
+    for(size_t i = 0; i < count; i++) {
+        threads_.emplace_back(&AsyncReader::workerLoop, this);
+    }
+}
+
+AsyncReader::~AsyncReader() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        slotCv_.wait(lock, [this]() {
+            return inFlight_ == 0;
+        });
+        stopping_ = true;
+#ifdef LSMDB_HAVE_IO_URING
+        if(ring_) {
+            ring_->push(IORING_OP_NOP, -1, 0, nullptr, 0, 0);
+        }
+#endif
+    }
+    queueCv_.notify_all();
+    for(auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void AsyncReader::read(std::shared_ptr<const RandomAccessFile> file, uint64_t offset, size_t size, Callback callback) {
+    if(offset > file->size() || size > file->size() - offset) {
+        throw std::runtime_error("Read past end of SSTable file");
+    }
+    auto request = std::make_unique<Request>();
+    request->file = std::move(file);
+    request->offset = offset;
+    request->data.resize(size);
+    request->done = 0;
+    request->callback = std::move(callback);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(currentReader != this) {
+        slotCv_.wait(lock, [this]() {
+            return inFlight_ < queueDepth_;
+        });
+    }
+    inFlight_++;
+    if(!ring_) {
+        queue_.push_back(std::move(request));
+        lock.unlock();
+        queueCv_.notify_one();
+        return;
+    }
+    try {
+        submit(request.get());
+    } catch(...) {
+        inFlight_--;
+        throw;
+    }
+    request.release();
+}
+
+void AsyncReader::submit(Request* request) {
+#ifdef LSMDB_HAVE_IO_URING
+    ring_->push(IORING_OP_READ, request->file->fd(), request->offset + request->done,
+        request->data.data() + request->done, static_cast<uint32_t>(request->data.size() - request->done),
+        reinterpret_cast<uint64_t>(request));
+#else
+    (void)request;
+#endif
+}
+
+void AsyncReader::completionLoop() {
+#ifdef LSMDB_HAVE_IO_URING
+    currentReader = this;
+    std::vector<std::pair<uint64_t, int>> completions;
+    bool stopped = false;
+    while(!stopped) {
+        ring_->waitForCompletion();
+        // Taken under mutex_, which orders each completion after the
+        // submission it answers.
+        completions.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            unsigned head = *ring_->cqHead;
+            unsigned tail = std::atomic_ref<unsigned>(*ring_->cqTail).load(std::memory_order_acquire);
+            for(; head != tail; head++) {
+                const io_uring_cqe& cqe = ring_->cqes[head & ring_->cqMask];
+                completions.emplace_back(cqe.user_data, cqe.res);
+            }
+            std::atomic_ref<unsigned>(*ring_->cqHead).store(head, std::memory_order_release);
+        }
+
+        for(auto [userData, result] : completions) {
+            if(userData == 0) {
+                stopped = true;
+                continue;
+            }
+
+            std::unique_ptr<Request> request(reinterpret_cast<Request*>(userData));
+            if(result <= 0) {
+                finish(std::move(request), std::make_exception_ptr(std::runtime_error("Failed to read SSTable file")));
+                continue;
+            }
+            request->done += static_cast<size_t>(result);
+            if(request->done < request->data.size()) {
+                // A short read; the rest is asked for again.
+                try {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    submit(request.get());
+                    request.release();
+                } catch(...) {
+                    finish(std::move(request), std::current_exception());
+                }
+                continue;
+            }
+            finish(std::move(request), nullptr);
+        }
+    }
+#endif
+}
+
+void AsyncReader::workerLoop() {
+    currentReader = this;
+    for(;;) {
+        std::unique_ptr<Request> request;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queueCv_.wait(lock, [this]() {
+                return stopping_ || !queue_.empty();
+            });
+            if(queue_.empty()) {
+                return;
+            }
+            request = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        std::exception_ptr error;
+        try {
+            std::string_view data = request->file->read(request->offset, request->data.size(), request->data);
+            if(data.data() != request->data.data()) {
+                request->data.assign(data);
+            }
+        } catch(...) {
+            error = std::current_exception();
+        }
+        finish(std::move(request), error);
+    }
+}
+
+void AsyncReader::finish(std::unique_ptr<Request> request, std::exception_ptr error) {
+    if(error) {
+        request->data.clear();
+    }
+    Callback callback = std::move(request->callback);
+    std::string data = std::move(request->data);
+    request.reset();
+    callback(std::move(data), error);
+
+    // The slot is given back only once the callback is done, so the
+    // destructor never returns while one is still running.
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inFlight_--;
+    }
+    slotCv_.notify_all();
+}
+
+}
\ No newline at end of file
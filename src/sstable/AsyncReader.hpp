@@ -0,0 +1,73 @@
+#ifndef LSMDB_ASYNCREADER_HPP
+#define LSMDB_ASYNCREADER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lsmdb {
+
+class RandomAccessFile;
+
+// Reads ranges of SSTable files without blocking the caller. Reads are
+// submitted to an io_uring where the kernel provides one and handed to a
+// pool of threads issuing preads otherwise. At most queueDepth reads are in
+// flight; read() waits for a slot, except when called from a callback.
+// Files must be read with pread, not mapped.
+class AsyncReader {
+public:
+    // Runs on a reader thread with the bytes read, or with error set.
+    using Callback = std::function<void(std::string data, std::exception_ptr error)>;
+
+private:
+    struct Ring;
+
+    struct Request {
+        std::shared_ptr<const RandomAccessFile> file;
+        uint64_t offset;
+        std::string data;
+        size_t done;
+        Callback callback;
+    };
+
+    size_t queueDepth_;
+    std::unique_ptr<Ring> ring_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable slotCv_;
+    size_t inFlight_;
+    bool stopping_;
+    // Reads waiting for a pool thread.
+    std::condition_variable queueCv_;
+    std::deque<std::unique_ptr<Request>> queue_;
+
+    // Requires mutex_.
+    void submit(Request* request);
+    void completionLoop();
+    void workerLoop();
+    void finish(std::unique_ptr<Request> request, std::exception_ptr error);
+
+public:
+    AsyncReader(size_t queueDepth, size_t fallbackThreads);
+    // Waits for every read in flight, callbacks included.
+    ~AsyncReader();
+
+    AsyncReader(const AsyncReader&) = delete;
+    AsyncReader& operator=(const AsyncReader&) = delete;
+
+    void read(std::shared_ptr<const RandomAccessFile> file, uint64_t offset, size_t size, Callback callback);
+
+    bool usesIOUring() const { return ring_ != nullptr; }
+};
+
+}
+
+#endif
\ No newline at end of file
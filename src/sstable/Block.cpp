@@ -0,0 +1,188 @@
+#include "Block.hpp"
+#include "TableFormat.hpp"
+#include <stdexcept>
+
+namespace lsmdb {
+
+BlockIterator::BlockIterator(std::string_view contents, uint32_t formatVersion)
+    : data_(contents)
+    , prefixed_(formatVersion >= FORMAT_PREFIX_KEYS)
+    , sequenced_(formatVersion >= FORMAT_SEQUENCED)
+    , current_(contents.size())
+    , next_(contents.size())
+    , restartIndex_(0)
+    , deleted_(false)
+    , sequence_(0) {
+    if(prefixed_) {
+        if(data_.size() < sizeof(uint32_t)) {
+            corrupt();
+        }
+        uint32_t numRestarts = decodeFixed32(data_.data() + data_.size() - sizeof(uint32_t));
+        size_t trailer = (static_cast<size_t>(numRestarts) + 1) * sizeof(uint32_t);
+        if(numRestarts == 0 || trailer > data_.size()) {
+            corrupt();
+        }
+        const char* p = data_.data() + data_.size() - trailer;
+        data_.remove_suffix(trailer);
+        restarts_.reserve(numRestarts);
+        for(uint32_t i = 0; i < numRestarts; i++) {
+            restarts_.push_back(decodeFixed32(p + i * sizeof(uint32_t)));
+        }
+    } else {
+        // Entries hold full keys, so each one can start a scan.
+        next_ = 0;
+        while(parseNext()) {
+            restarts_.push_back(static_cast<uint32_t>(current_));
+        }
+    }
+    current_ = data_.size();
+    next_ = data_.size();
+}
+
+void BlockIterator::corrupt() {
+    throw std::runtime_error("Corrupt SSTable block");
+}
+
+void BlockIterator::seekToRestart(size_t index) {
+    restartIndex_ = index;
+    key_.clear();
+    next_ = restarts_[index];
+    if(next_ > data_.size()) {
+        corrupt();
+    }
+}
+
+bool BlockIterator::parseNext() {
+    current_ = next_;
+    if(current_ >= data_.size()) {
+        current_ = data_.size();
+        return false;
+    }
+
+    const char* p = data_.data() + current_;
+    const char* limit = data_.data() + data_.size();
+    uint64_t shared = 0;
+    uint64_t unshared;
+    uint64_t valueSize;
+    if(prefixed_) {
+        // [shared][unshared][value size] varints, [u8 deleted][u64 sequence],
+        // the unshared key bytes, then the value.
+        if(!getVarint(p, limit, shared) || !getVarint(p, limit, unshared) || !getVarint(p, limit, valueSize)) {
+            corrupt();
+        }
+        if(shared > key_.size() || unshared > static_cast<size_t>(limit - p) || static_cast<size_t>(limit - p) - unshared < 1 + sizeof(uint64_t)) {
+            corrupt();
+        }
+        deleted_ = *p++ != 0;
+        sequence_ = decodeFixed64(p);
+        p += sizeof(uint64_t);
+        key_.resize(shared);
+        key_.append(p, unshared);
+        p += unshared;
+    } else {
+        // [u8 deleted][u32 key size][key], the u64 sequence in sequenced
+        // formats, then [u32 value size][value].
+        if(static_cast<size_t>(limit - p) < 1 + sizeof(uint32_t)) {
+            corrupt();
+        }
+        deleted_ = *p++ != 0;
+        unshared = decodeFixed32(p);
+        p += sizeof(uint32_t);
+        size_t sequenceSize = sequenced_ ? sizeof(uint64_t) : 0;
+        if(unshared > static_cast<size_t>(limit - p) || static_cast<size_t>(limit - p) - unshared < sequenceSize + sizeof(uint32_t)) {
+            corrupt();
+        }
+        key_.assign(p, unshared);
+        p += unshared;
+        sequence_ = 0;
+        if(sequenced_) {
+            sequence_ = decodeFixed64(p);
+            p += sizeof(uint64_t);
+        }
+        valueSize = decodeFixed32(p);
+        p += sizeof(uint32_t);
+    }
+
+    if(static_cast<size_t>(limit - p) < valueSize) {
+        corrupt();
+    }
+    value_ = std::string_view(p, valueSize);
+    next_ = (p + valueSize) - data_.data();
+    while(restartIndex_ + 1 < restarts_.size() && restarts_[restartIndex_ + 1] <= current_) {
+        restartIndex_++;
+    }
+    return true;
+}
+
+void BlockIterator::seekToFirst() {
+    if(restarts_.empty()) {
+        current_ = data_.size();
+        return;
+    }
+    seekToRestart(0);
+    parseNext();
+}
+
+void BlockIterator::seekToLast() {
+    if(restarts_.empty()) {
+        current_ = data_.size();
+        return;
+    }
+    seekToRestart(restarts_.size() - 1);
+    while(parseNext() && next_ < data_.size()) {
+    }
+}
+
+void BlockIterator::seek(std::string_view target, uint64_t sequence) {
+    auto before = [&]() {
+        int cmp = std::string_view(key_).compare(target);
+        return cmp < 0 || (cmp == 0 && sequence_ > sequence);
+    };
+
+    // Last restart point whose entry sorts before the target.
+    size_t left = 0;
+    size_t right = restarts_.size();
+    while(left + 1 < right) {
+        size_t mid = (left + right) / 2;
+        seekToRestart(mid);
+        if(!parseNext()) {
+            corrupt();
+        }
+        if(before()) {
+            left = mid;
+        } else {
+            right = mid;
+        }
+    }
+
+    if(restarts_.empty()) {
+        current_ = data_.size();
+        return;
+    }
+    seekToRestart(left);
+    while(parseNext() && before()) {
+    }
+}
+
+void BlockIterator::next() {
+    parseNext();
+}
+
+void BlockIterator::prev() {
+    // Keys only decode forwards from a restart point, so back up to the
+    // one before the current entry and scan up to it.
+    size_t original = current_;
+    while(restarts_[restartIndex_] >= original) {
+        if(restartIndex_ == 0) {
+            current_ = data_.size();
+            next_ = data_.size();
+            return;
+        }
+        restartIndex_--;
+    }
+    seekToRestart(restartIndex_);
+    while(parseNext() && next_ < original) {
+    }
+}
+
+}
\ No newline at end of file
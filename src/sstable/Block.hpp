@@ -0,0 +1,56 @@
+#ifndef LSMDB_BLOCK_HPP
+#define LSMDB_BLOCK_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lsmdb {
+
+// Cursor over the entries of one decoded data block, in table order. In
+// prefix-compressed blocks each key stores only what differs from the key
+// before it, except at restart points, whose offsets the block ends with;
+// seek() binary-searches those before scanning. Blocks of older formats
+// hold full keys and every entry serves as a restart point. The contents
+// must outlive the iterator; key() stays valid until it is moved.
+class BlockIterator {
+private:
+    std::string_view data_;
+    bool prefixed_;
+    bool sequenced_;
+    std::vector<uint32_t> restarts_;
+
+    size_t current_;
+    size_t next_;
+    size_t restartIndex_;
+    std::string key_;
+    std::string_view value_;
+    bool deleted_;
+    uint64_t sequence_;
+
+    void seekToRestart(size_t index);
+    bool parseNext();
+    static void corrupt();
+
+public:
+    BlockIterator(std::string_view contents, uint32_t formatVersion);
+
+    bool valid() const { return current_ < data_.size(); }
+    void seekToFirst();
+    void seekToLast();
+    // First entry at or after (target, sequence): key ascending, then
+    // sequence number descending.
+    void seek(std::string_view target, uint64_t sequence);
+    void next();
+    void prev();
+
+    std::string_view key() const { return key_; }
+    std::string_view value() const { return value_; }
+    bool deleted() const { return deleted_; }
+    uint64_t sequence() const { return sequence_; }
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "BloomFilter.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace lsmdb {
+
+uint32_t BloomFilter::hash(std::string_view key) {
+    // Murmur-style mixing, the same construction LevelDB uses for its filters.
+    const uint32_t seed = 0xbc9f1d34;
+    const uint32_t m = 0xc6a4a793;
+    const char* data = key.data();
+    size_t n = key.size();
+    uint32_t h = seed ^ static_cast<uint32_t>(n * m);
+
+    while(n >= 4) {
+        uint32_t w;
+        std::memcpy(&w, data, sizeof(w));
+        data += 4;
+        n -= 4;
+        h += w;
+        h *= m;
+        h ^= (h >> 16);
+    }
+
+    switch(n) {
+        case 3:
+            h += static_cast<uint8_t>(data[2]) << 16;
+            [[fallthrough]];
+        case 2:
+            h += static_cast<uint8_t>(data[1]) << 8;
+            [[fallthrough]];
+        case 1:
+            h += static_cast<uint8_t>(data[0]);
+            h *= m;
+            h ^= (h >> 24);
+            break;
+    }
+    return h;
+}
+
+std::string BloomFilter::build(const std::vector<std::string_view>& keys, size_t bitsPerKey) {
+    std::vector<uint32_t> hashes;
+    hashes.reserve(keys.size());
+    for(const auto& key : keys) {
+        hashes.push_back(hash(key));
+    }
+    return buildFromHashes(hashes, bitsPerKey);
+}
+
+std::string BloomFilter::buildFromHashes(const std::vector<uint32_t>& hashes, size_t bitsPerKey) {
+    size_t probes = static_cast<size_t>(bitsPerKey * 0.69);
+    probes = std::clamp<size_t>(probes, 1, 30);
+
+    size_t bits = std::max<size_t>(hashes.size() * bitsPerKey, 64);
+    size_t bytes = (bits + 7) / 8;
+    bits = bytes * 8;
+
+    std::string filter(bytes + 1, '\0');
+    filter[bytes] = static_cast<char>(probes);
+
+    for(uint32_t h : hashes) {
+        // Double hashing: derive all probe positions from a single hash.
+        const uint32_t delta = (h >> 17) | (h << 15);
+        for(size_t i = 0; i < probes; i++) {
+            const uint32_t bit = h % bits;
+            filter[bit / 8] |= static_cast<char>(1 << (bit % 8));
+            h += delta;
+        }
+    }
+    return filter;
+}
+
+bool BloomFilter::mayContain(std::string_view filter, std::string_view key) {
+    if(filter.size() < 2) {
+        return true;
+    }
+
+    const size_t bits = (filter.size() - 1) * 8;
+    const size_t probes = static_cast<uint8_t>(filter.back());
+    if(probes > 30) {
+        return true;
+    }
+
+    uint32_t h = hash(key);
+    const uint32_t delta = (h >> 17) | (h << 15);
+    for(size_t i = 0; i < probes; i++) {
+        const uint32_t bit = h % bits;
+        if((filter[bit / 8] & (1 << (bit % 8))) == 0) {
+            return false;
+        }
+        h += delta;
+    }
+    return true;
+}
+
+}
\ No newline at end of file
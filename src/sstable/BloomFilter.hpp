@@ -0,0 +1,27 @@
+#ifndef LSMDB_BLOOMFILTER_HPP
+#define LSMDB_BLOOMFILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lsmdb {
+
+class BloomFilter {
+public:
+    static uint32_t hash(std::string_view key);
+
+    // The last byte of a filter holds the number of probes, so a filter
+    // built with different settings can still be read.
+    static std::string build(const std::vector<std::string_view>& keys, size_t bitsPerKey);
+    // Same, from the hash() of each key, for writers that cannot keep
+    // every key around until the filter is built.
+    static std::string buildFromHashes(const std::vector<uint32_t>& hashes, size_t bitsPerKey);
+    static bool mayContain(std::string_view filter, std::string_view key);
+};
+
+}
+
+#endif
\ No newline at end of file
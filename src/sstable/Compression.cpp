@@ -0,0 +1,175 @@
+#include "Compression.hpp"
+#include "TableFormat.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace lsmdb {
+
+namespace {
+
+// Each sequence is a token byte (literal length in the high nibble, match
+// length minus MIN_MATCH in the low one, 15 meaning more length bytes
+// follow), the literals, then a 2-byte match offset. The last sequence
+// has literals only. The block starts with its uncompressed size as a
+// varint.
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_BITS = 14;
+// No input byte decodes to more than 255 output bytes, which bounds the
+// size a valid block may claim.
+constexpr size_t MAX_EXPANSION = 255;
+
+uint32_t load32(const char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t hashOf(uint32_t value, int bits) {
+    return (value * 2654435761u) >> (32 - bits);
+}
+
+void putLength(std::string& dst, size_t length) {
+    while(length >= 255) {
+        dst.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    dst.push_back(static_cast<char>(length));
+}
+
+bool getLength(const char*& p, const char* limit, size_t& length) {
+    uint8_t byte;
+    do {
+        if(p >= limit) {
+            return false;
+        }
+        byte = static_cast<uint8_t>(*p++);
+        length += byte;
+    } while(byte == 255);
+    return true;
+}
+
+void emitSequence(std::string& dst, const char* literals, size_t literalLength, size_t matchLength, size_t offset) {
+    size_t tokenLiterals = literalLength < 15 ? literalLength : 15;
+    size_t tokenMatch = 0;
+    if(matchLength > 0) {
+        size_t extra = matchLength - MIN_MATCH;
+        tokenMatch = extra < 15 ? extra : 15;
+    }
+    dst.push_back(static_cast<char>((tokenLiterals << 4) | tokenMatch));
+    if(literalLength >= 15) {
+        putLength(dst, literalLength - 15);
+    }
+    dst.append(literals, literalLength);
+    if(matchLength > 0) {
+        dst.push_back(static_cast<char>(offset & 0xff));
+        dst.push_back(static_cast<char>(offset >> 8));
+        if(matchLength - MIN_MATCH >= 15) {
+            putLength(dst, matchLength - MIN_MATCH - 15);
+        }
+    }
+}
+
+}
+
+void LZCodec::compress(std::string_view input, std::string& output) {
+    output.clear();
+    output.reserve(input.size() + input.size() / 255 + 16);
+    putVarint(output, input.size());
+
+    const char* base = input.data();
+    const char* end = base + input.size();
+    const char* anchor = base;
+    const char* p = base;
+
+    if(input.size() >= MIN_MATCH) {
+        // Sized to the input, so a small block does not pay for clearing the
+        // whole table, and kept per thread to avoid an allocation per block.
+        int bits = 8;
+        while(bits < HASH_BITS && (size_t(1) << bits) < input.size()) {
+            bits++;
+        }
+        thread_local std::vector<uint32_t> table;
+        if(table.size() < (size_t(1) << bits)) {
+            table.resize(size_t(1) << bits);
+        }
+        std::fill_n(table.begin(), size_t(1) << bits, 0);
+        const char* matchLimit = end - MIN_MATCH;
+        while(p <= matchLimit) {
+            uint32_t value = load32(p);
+            uint32_t& slot = table[hashOf(value, bits)];
+            const char* candidate = base + slot;
+            slot = static_cast<uint32_t>(p - base);
+
+            if(candidate >= p || static_cast<size_t>(p - candidate) > MAX_OFFSET || load32(candidate) != value) {
+                p++;
+                continue;
+            }
+
+            size_t length = MIN_MATCH;
+            while(p + length < end && candidate[length] == p[length]) {
+                length++;
+            }
+            emitSequence(output, anchor, p - anchor, length, p - candidate);
+            p += length;
+            anchor = p;
+        }
+    }
+
+    emitSequence(output, anchor, end - anchor, 0, 0);
+}
+
+bool LZCodec::decompress(std::string_view input, std::string& output) {
+    const char* p = input.data();
+    const char* limit = p + input.size();
+    uint64_t size;
+    if(!getVarint(p, limit, size) || size > input.size() * MAX_EXPANSION) {
+        return false;
+    }
+
+    output.clear();
+    output.reserve(size);
+    while(p < limit) {
+        uint8_t token = static_cast<uint8_t>(*p++);
+        size_t literalLength = token >> 4;
+        if(literalLength == 15 && !getLength(p, limit, literalLength)) {
+            return false;
+        }
+        if(static_cast<size_t>(limit - p) < literalLength || output.size() + literalLength > size) {
+            return false;
+        }
+        output.append(p, literalLength);
+        p += literalLength;
+
+        if(p == limit) {
+            break;
+        }
+
+        if(limit - p < 2) {
+            return false;
+        }
+        size_t offset = static_cast<uint8_t>(p[0]) | (static_cast<size_t>(static_cast<uint8_t>(p[1])) << 8);
+        p += 2;
+        size_t matchLength = token & 0x0f;
+        if(matchLength == 15 && !getLength(p, limit, matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if(offset == 0 || offset > output.size() || output.size() + matchLength > size) {
+            return false;
+        }
+        // Matches may overlap their own output, so copy byte by byte.
+        size_t pos = output.size();
+        output.resize(pos + matchLength);
+        char* out = output.data() + pos;
+        for(size_t i = 0; i < matchLength; i++) {
+            out[i] = out[i - offset];
+        }
+    }
+    return output.size() == size;
+}
+
+}
\ No newline at end of file
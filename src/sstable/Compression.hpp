@@ -0,0 +1,22 @@
+#ifndef LSMDB_COMPRESSION_HPP
+#define LSMDB_COMPRESSION_HPP
+
+#include <string>
+#include <string_view>
+
+namespace lsmdb {
+
+// Built-in LZ77 codec in the style of LZ4: runs of literals and back
+// references into the previous 64 KiB, with no entropy coding. Fast in
+// both directions and free of external dependencies.
+class LZCodec {
+public:
+    // Replaces output with the compressed form of input.
+    static void compress(std::string_view input, std::string& output);
+    // Returns false if input is not a valid compressed block.
+    static bool decompress(std::string_view input, std::string& output);
+};
+
+}
+
+#endif
\ No newline at end of file
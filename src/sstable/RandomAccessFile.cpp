@@ -0,0 +1,69 @@
+#include "RandomAccessFile.hpp"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lsmdb {
+
+RandomAccessFile::RandomAccessFile(const std::filesystem::path& path, bool useMmap)
+    : fd_(-1)
+    , base_(nullptr)
+    , size_(0) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        throw std::runtime_error("Failed to open SSTable file");
+    }
+
+    struct stat st;
+    if(::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat SSTable file");
+    }
+    size_ = static_cast<uint64_t>(st.st_size);
+
+    if(useMmap && size_ > 0) {
+        void* base = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if(base != MAP_FAILED) {
+            // The mapping outlives the descriptor, so mapped tables hold no fd.
+            base_ = static_cast<const char*>(base);
+            ::close(fd);
+            return;
+        }
+    }
+    fd_ = fd;
+}
+
+RandomAccessFile::~RandomAccessFile() {
+    if(base_) {
+        ::munmap(const_cast<char*>(base_), size_);
+    }
+    if(fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+std::string_view RandomAccessFile::read(uint64_t offset, size_t n, std::string& scratch) const {
+    if(offset > size_ || n > size_ - offset) {
+        throw std::runtime_error("Read past end of SSTable file");
+    }
+
+    if(base_) {
+        return std::string_view(base_ + offset, n);
+    }
+
+    scratch.resize(n);
+    size_t done = 0;
+    while(done < n) {
+        ssize_t r = ::pread(fd_, scratch.data() + done, n - done, static_cast<off_t>(offset + done));
+        if(r <= 0) {
+            throw std::runtime_error("Failed to read SSTable file");
+        }
+        done += static_cast<size_t>(r);
+    }
+    return std::string_view(scratch.data(), n);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef LSMDB_RANDOMACCESSFILE_HPP
+#define LSMDB_RANDOMACCESSFILE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace lsmdb {
+
+// Read-only handle to an SSTable file that stays open for as long as it is
+// referenced. Mapped files hand out views straight into the mapping;
+// otherwise reads are positional preads into a caller-provided buffer.
+class RandomAccessFile {
+private:
+    int fd_;
+    const char* base_;
+    uint64_t size_;
+
+public:
+    RandomAccessFile(const std::filesystem::path& path, bool useMmap);
+    ~RandomAccessFile();
+
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+    std::string_view read(uint64_t offset, size_t n, std::string& scratch) const;
+
+    bool isMapped() const { return base_ != nullptr; }
+    // -1 for mapped files, which hold no descriptor.
+    int fd() const { return fd_; }
+    uint64_t size() const { return size_; }
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -1,183 +1,700 @@
-#include "SSTable.hpp"
-#include <fstream>
-#include <algorithm>
-
-namespace lsmdb {
-
-SSTable::SSTable(const std::filesystem::path& path) : path_(path) {
-    if(std::filesystem::exists(path_)) {
-        loadIndex();
-    }
-}
-
-void SSTable::writeEntry(std::ofstream& file, const std::string& key, const std::string& value, bool deleted) {
-    uint8_t deletedFlag = deleted ? 1 : 0;
-    uint32_t keySize = key.size();
-    uint32_t valueSize = value.size();
-    
-    file.write(reinterpret_cast<const char*>(&deletedFlag), sizeof(deletedFlag));
-    file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
-    file.write(key.data(), keySize);
-    file.write(reinterpret_cast<const char*>(&valueSize), sizeof(valueSize));
-    file.write(value.data(), valueSize);
-}
-
-void SSTable::create(const std::filesystem::path& path, const std::vector<SSTableEntry>& entries) {
-    std::ofstream file(path, std::ios::binary);
-    if(!file) {
-        throw std::runtime_error("Failed to create SSTable file");
-    }
-    
-    std::vector<SSTableEntry> sorted = entries;
-    std::sort(sorted.begin(), sorted.end(), [](const SSTableEntry& a, const SSTableEntry& b) {
-        return a.key < b.key;
-    });
-    
-    std::vector<IndexEntry> index;
-    for(const auto& entry : sorted) {
-        uint64_t offset = file.tellp();
-        index.push_back({entry.key, offset});
-        
-        uint8_t deletedFlag = entry.deleted ? 1 : 0;
-        uint32_t keySize = entry.key.size();
-        uint32_t valueSize = entry.value.size();
-        
-        file.write(reinterpret_cast<const char*>(&deletedFlag), sizeof(deletedFlag));
-        file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
-        file.write(entry.key.data(), keySize);
-        file.write(reinterpret_cast<const char*>(&valueSize), sizeof(valueSize));
-        file.write(entry.value.data(), valueSize);
-    }
-    
-    uint64_t indexStartOffset = file.tellp();
-    uint32_t indexSize = index.size();
-    file.write(reinterpret_cast<const char*>(&indexSize), sizeof(indexSize));
-    
-    for(const auto& entry : index) {
-        uint32_t keySize = entry.key.size();
-        file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
-        file.write(entry.key.data(), keySize);
-        file.write(reinterpret_cast<const char*>(&entry.offset), sizeof(entry.offset));
-    }
-    file.write(reinterpret_cast<const char*>(&indexStartOffset), sizeof(indexStartOffset));
-}
-
-void SSTable::loadIndex() {
-    std::ifstream file(path_, std::ios::binary);
-    if(!file) {
-        throw std::runtime_error("Failed to open SSTable file");
-    }
-    
-    file.seekg(-static_cast<std::streamoff>(sizeof(uint64_t)), std::ios::end);
-    
-    uint64_t indexStartOffset;
-    file.read(reinterpret_cast<char*>(&indexStartOffset), sizeof(indexStartOffset));
-
-    file.seekg(indexStartOffset);
-
-    uint32_t indexSize;
-    file.read(reinterpret_cast<char*>(&indexSize), sizeof(indexSize));
-    
-    index_.reserve(indexSize);
-    for(uint32_t i = 0; i < indexSize; i++) {
-        uint32_t keySize;
-        file.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
-        
-        std::string key(keySize, '\0');
-        file.read(&key[0], keySize);
-        
-        uint64_t offset;
-        file.read(reinterpret_cast<char*>(&offset), sizeof(offset));
-        
-        index_.push_back({std::move(key), offset});
-    }
-}
-
-std::optional<std::string> SSTable::get(const std::string& key) const {
-    auto it = std::lower_bound(index_.begin(), index_.end(), key,
-        [](const IndexEntry& entry, const std::string& k) {
-            return entry.key < k;
-        });
-    
-    if(it == index_.end() || it->key != key) {
-        return std::nullopt;
-    }
-    
-    std::ifstream file(path_, std::ios::binary);
-    if(!file) {
-        return std::nullopt;
-    }
-    
-    file.seekg(it->offset);
-    
-    uint8_t deletedFlag;
-    uint32_t keySize;
-    uint32_t valueSize;
-    
-    file.read(reinterpret_cast<char*>(&deletedFlag), sizeof(deletedFlag));
-    file.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
-    
-    file.seekg(keySize, std::ios::cur);
-    
-    file.read(reinterpret_cast<char*>(&valueSize), sizeof(valueSize));
-    
-    if(deletedFlag) {
-        return std::nullopt;
-    }
-    
-    std::string value(valueSize, '\0');
-    file.read(&value[0], valueSize);
-    
-    return value;
-}
-
-bool SSTable::contains(const std::string& key) const {
-    auto it = std::lower_bound(index_.begin(), index_.end(), key,
-        [](const IndexEntry& entry, const std::string& k) {
-            return entry.key < k;
-        });
-    
-    return it != index_.end() && it->key == key;
-}
-
-std::vector<SSTableEntry> SSTable::readAll() const {
-    std::vector<SSTableEntry> entries;
-    std::ifstream file(path_, std::ios::binary);
-    
-    if(!file) {
-        return entries;
-    }
-    
-    for(const auto& idx : index_) {
-        file.seekg(idx.offset);
-        
-        uint8_t deletedFlag;
-        uint32_t keySize;
-        uint32_t valueSize;
-        
-        file.read(reinterpret_cast<char*>(&deletedFlag), sizeof(deletedFlag));
-        file.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
-        
-        std::string key(keySize, '\0');
-        file.read(&key[0], keySize);
-        
-        file.read(reinterpret_cast<char*>(&valueSize), sizeof(valueSize));
-        
-        std::string value(valueSize, '\0');
-        file.read(&value[0], valueSize);
-        
-        entries.push_back({std::move(key), std::move(value), deletedFlag != 0});
-    }
-    
-    return entries;
-}
-
-const std::filesystem::path& SSTable::getPath() const {
-    return path_;
-}
-
-size_t SSTable::size() const {
-    return index_.size();
-}
-
+#include "SSTable.hpp"
+#include "Block.hpp"
+#include "BloomFilter.hpp"
+#include "Compression.hpp"
+#include "RandomAccessFile.hpp"
+#include "SSTableBuilder.hpp"
+#include "TableCache.hpp"
+#include "TableFormat.hpp"
+#include "cache/BlockCache.hpp"
+#include "checksum/CRC32C.hpp"
+#include "iterator/InternalIterator.hpp"
+#include <atomic>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+namespace lsmdb {
+
+namespace {
+
+std::atomic<uint64_t> nextTableId{1};
+
+// Strips the checksum ending data, throwing if verify is set and it does
+// not match.
+std::string_view checkedContents(std::string_view data, bool verify) {
+    if(data.size() < sizeof(uint32_t)) {
+        throw std::runtime_error("Corrupt SSTable block");
+    }
+    data.remove_suffix(sizeof(uint32_t));
+    if(verify && CRC32C::unmask(decodeFixed32(data.data() + data.size())) != CRC32C::value(data)) {
+        throw std::runtime_error("SSTable checksum mismatch");
+    }
+    return data;
+}
+
+}
+
+SSTable::SSTable(const std::filesystem::path& path, const TableContext& context) 
+    : path_(path)
+    , formatVersion_(FORMAT_LEGACY)
+    , numEntries_(0)
+    , largestSequence_(0)
+    , context_(context)
+    , id_(nextTableId.fetch_add(1, std::memory_order_relaxed))
+    , fileSize_(0)
+    , obsolete_(false) {
+    if(std::filesystem::exists(path_)) {
+        fileSize_ = std::filesystem::file_size(path_);
+        loadIndex();
+    }
+}
+
+SSTable::~SSTable() {
+    if(context_.tableCache) {
+        context_.tableCache->evict(id_);
+    }
+    if(obsolete_) {
+        std::error_code ec;
+        std::filesystem::remove(path_, ec);
+    }
+}
+
+void SSTable::writeEntry(std::ofstream& file, const std::string& key, const std::string& value, bool deleted) {
+    uint8_t deletedFlag = deleted ? 1 : 0;
+    uint32_t keySize = key.size();
+    uint32_t valueSize = value.size();
+    
+    file.write(reinterpret_cast<const char*>(&deletedFlag), sizeof(deletedFlag));
+    file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+    file.write(key.data(), keySize);
+    file.write(reinterpret_cast<const char*>(&valueSize), sizeof(valueSize));
+    file.write(value.data(), valueSize);
+}
+
+void SSTable::create(const std::filesystem::path& path, const std::vector<SSTableEntry>& entries, const Options& options) {
+    std::vector<const SSTableEntry*> sorted;
+    sorted.reserve(entries.size());
+    for(const auto& entry : entries) {
+        sorted.push_back(&entry);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const SSTableEntry* a, const SSTableEntry* b) {
+        return a->key < b->key || (a->key == b->key && a->sequence > b->sequence);
+    });
+
+    SSTableBuilder builder(path, options);
+    for(const auto* entry : sorted) {
+        builder.add(entry->key, entry->value, entry->deleted, entry->sequence);
+    }
+    builder.finish();
+}
+
+void SSTable::loadIndex() {
+    std::ifstream file(path_, std::ios::binary);
+    if(!file) {
+        throw std::runtime_error("Failed to open SSTable file");
+    }
+
+    if(fileSize_ >= FOOTER_SIZE) {
+        char footer[FOOTER_SIZE];
+        file.seekg(-static_cast<std::streamoff>(FOOTER_SIZE), std::ios::end);
+        file.read(footer, FOOTER_SIZE);
+        if(file && decodeFixed64(footer + FOOTER_SIZE - sizeof(uint64_t)) == TABLE_MAGIC) {
+            loadBlockIndex(file, footer);
+            return;
+        }
+        file.clear();
+    }
+    loadLegacyIndex(file);
+}
+
+void SSTable::loadBlockIndex(std::ifstream& file, const char* footer) {
+    uint64_t filterOffset = decodeFixed64(footer);
+    uint64_t filterSize = decodeFixed64(footer + 8);
+    uint64_t indexOffset = decodeFixed64(footer + 16);
+    uint64_t indexSize = decodeFixed64(footer + 24);
+    formatVersion_ = decodeFixed32(footer + 32);
+
+    if(formatVersion_ < FORMAT_BLOCK_BASED || formatVersion_ > FORMAT_CHECKSUMMED || indexOffset + indexSize > fileSize_ || filterOffset + filterSize > fileSize_) {
+        throw std::runtime_error("Unsupported or corrupt SSTable file");
+    }
+
+    filter_.resize(filterSize);
+    file.seekg(filterOffset);
+    file.read(filter_.data(), filterSize);
+
+    std::string index(indexSize, '\0');
+    file.seekg(indexOffset);
+    file.read(index.data(), indexSize);
+    if(!file) {
+        throw std::runtime_error("Failed to read SSTable index");
+    }
+    if(formatVersion_ >= FORMAT_CHECKSUMMED) {
+        if(!filter_.empty()) {
+            filter_.resize(checkedContents(filter_, true).size());
+        }
+        index.resize(checkedContents(index, true).size());
+    }
+
+    const char* p = index.data();
+    const char* limit = p + index.size();
+    auto need = [&](size_t n) {
+        if(static_cast<size_t>(limit - p) < n) {
+            throw std::runtime_error("Corrupt SSTable index");
+        }
+    };
+
+    need(sizeof(uint32_t));
+    uint32_t numBlocks = decodeFixed32(p);
+    p += sizeof(uint32_t);
+
+    blocks_.reserve(numBlocks);
+    for(uint32_t i = 0; i < numBlocks; i++) {
+        need(sizeof(uint32_t));
+        uint32_t keySize = decodeFixed32(p);
+        p += sizeof(uint32_t);
+        need(keySize + sizeof(uint64_t) + sizeof(uint32_t));
+        std::string lastKey(p, keySize);
+        p += keySize;
+        uint64_t offset = decodeFixed64(p);
+        p += sizeof(uint64_t);
+        uint32_t size = decodeFixed32(p);
+        p += sizeof(uint32_t);
+        blocks_.push_back({std::move(lastKey), offset, size});
+    }
+
+    need(sizeof(uint32_t));
+    uint32_t smallestSize = decodeFixed32(p);
+    p += sizeof(uint32_t);
+    need(smallestSize + sizeof(uint64_t));
+    smallestKey_.assign(p, smallestSize);
+    p += smallestSize;
+    numEntries_ = decodeFixed64(p);
+    p += sizeof(uint64_t);
+    if(formatVersion_ >= FORMAT_SEQUENCED) {
+        need(sizeof(uint64_t));
+        largestSequence_ = decodeFixed64(p);
+    }
+
+    if(!blocks_.empty()) {
+        largestKey_ = blocks_.back().lastKey;
+    }
+}
+
+void SSTable::loadLegacyIndex(std::ifstream& file) {
+    file.seekg(-static_cast<std::streamoff>(sizeof(uint64_t)), std::ios::end);
+    
+    uint64_t indexStartOffset;
+    file.read(reinterpret_cast<char*>(&indexStartOffset), sizeof(indexStartOffset));
+
+    file.seekg(indexStartOffset);
+
+    uint32_t indexSize;
+    file.read(reinterpret_cast<char*>(&indexSize), sizeof(indexSize));
+    
+    index_.reserve(indexSize);
+    for(uint32_t i = 0; i < indexSize; i++) {
+        uint32_t keySize;
+        file.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
+        
+        std::string key(keySize, '\0');
+        file.read(&key[0], keySize);
+        
+        uint64_t offset;
+        file.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+        
+        index_.push_back({std::move(key), offset});
+    }
+
+    uint64_t indexEnd = file.tellg();
+    if(indexEnd + sizeof(uint64_t) < fileSize_) {
+        uint32_t filterSize;
+        file.read(reinterpret_cast<char*>(&filterSize), sizeof(filterSize));
+        filter_.resize(filterSize);
+        file.read(&filter_[0], filterSize);
+        if(!file) {
+            filter_.clear();
+        }
+    }
+
+    numEntries_ = index_.size();
+    if(!index_.empty()) {
+        smallestKey_ = index_.front().key;
+        largestKey_ = index_.back().key;
+        // Legacy entries run contiguously up to the index, so the whole data
+        // region can be scanned as a single block.
+        blocks_.push_back({largestKey_, 0, static_cast<uint32_t>(indexStartOffset)});
+    }
+}
+
+std::shared_ptr<const RandomAccessFile> SSTable::openFile() const {
+    if(context_.tableCache) {
+        return context_.tableCache->open(id_, path_);
+    }
+    return std::make_shared<const RandomAccessFile>(path_, false);
+}
+
+bool SSTable::storedCompressed(std::string_view raw) const {
+    if(formatVersion_ >= FORMAT_CHECKSUMMED) {
+        return raw.size() >= BLOCK_TRAILER_SIZE && static_cast<CompressionType>(raw[raw.size() - BLOCK_TRAILER_SIZE]) != CompressionType::NONE;
+    }
+    return formatVersion_ >= FORMAT_COMPRESSED && !raw.empty() && static_cast<CompressionType>(raw.back()) != CompressionType::NONE;
+}
+
+// Strips the trailer of a block as stored, verifying its checksum when
+// asked, and decompresses it if needed; the result points into raw or into
+// buffer.
+std::string_view SSTable::blockContents(std::string_view raw, std::string& buffer, bool verifyChecksums) const {
+    if(formatVersion_ < FORMAT_COMPRESSED) {
+        return raw;
+    }
+    if(formatVersion_ >= FORMAT_CHECKSUMMED) {
+        raw = checkedContents(raw, verifyChecksums);
+    }
+    if(raw.empty()) {
+        throw std::runtime_error("Corrupt SSTable block");
+    }
+    auto type = static_cast<CompressionType>(raw.back());
+    raw.remove_suffix(1);
+    if(type == CompressionType::NONE) {
+        return raw;
+    }
+    if(type != CompressionType::LZ) {
+        throw std::runtime_error("Unsupported SSTable block compression");
+    }
+    if(!LZCodec::decompress(raw, buffer)) {
+        throw std::runtime_error("Corrupt SSTable block");
+    }
+    return buffer;
+}
+
+SSTable::Block SSTable::loadBlock(const BlockHandle& handle, bool verifyChecksums, bool fillCache) const {
+    return loadBlock(openFile(), handle, verifyChecksums, fillCache);
+}
+
+SSTable::Block SSTable::loadBlock(const std::shared_ptr<const RandomAccessFile>& file, const BlockHandle& handle, bool verifyChecksums, bool fillCache) const {
+    std::string scratch;
+
+    // A mapped file already serves uncompressed blocks without a copy or a
+    // syscall; compressed ones are decompressed once and cached.
+    std::string_view raw;
+    if(file->isMapped()) {
+        raw = file->read(handle.offset, handle.size, scratch);
+        if(!storedCompressed(raw)) {
+            return {blockContents(raw, scratch, verifyChecksums), file};
+        }
+    }
+
+    BlockCache* cache = context_.blockCache;
+    if(cache) {
+        if(auto block = cache->lookup(id_, handle.offset)) {
+            record(Ticker::BLOCK_CACHE_HIT);
+            return {*block, block};
+        }
+        record(Ticker::BLOCK_CACHE_MISS);
+    }
+
+    if(!file->isMapped()) {
+        raw = file->read(handle.offset, handle.size, scratch);
+    }
+    return storeBlock(handle, raw, scratch, verifyChecksums, fillCache);
+}
+
+// Turns a block as read (raw, which may point into scratch) into its
+// contents, adding them to the cache if fillCache is true.
+SSTable::Block SSTable::storeBlock(const BlockHandle& handle, std::string_view raw, std::string& scratch, bool verifyChecksums, bool fillCache) const {
+    BlockCache* cache = fillCache ? context_.blockCache : nullptr;
+    std::string buffer;
+    // Cached blocks are shared with readers that do want them verified.
+    std::string_view contents = blockContents(raw, buffer, verifyChecksums || cache);
+    if(contents.data() != buffer.data()) {
+        // Stored uncompressed and read into scratch; only the trailer goes.
+        scratch.resize(contents.size());
+        buffer = std::move(scratch);
+    }
+
+    std::shared_ptr<const std::string> block;
+    if(cache) {
+        block = cache->insert(id_, handle.offset, std::move(buffer));
+    } else {
+        block = std::make_shared<const std::string>(std::move(buffer));
+    }
+    return {*block, block};
+}
+
+void SSTable::record(Ticker ticker) const {
+    if(context_.statistics) {
+        context_.statistics->record(ticker);
+    }
+}
+
+const SSTable::BlockHandle* SSTable::findBlock(std::string_view key) const {
+    auto it = std::lower_bound(blocks_.begin(), blocks_.end(), key,
+        [](const BlockHandle& handle, std::string_view k) {
+            return handle.lastKey < k;
+        });
+    return it == blocks_.end() ? nullptr : &*it;
+}
+
+bool SSTable::findEntry(std::string_view key, uint64_t sequence, bool verifyChecksums, ReadState& state, std::string_view& value, bool& deleted) const {
+    // Versions of a key are contiguous, newest first, and may run on into
+    // the following block.
+    const BlockHandle* handle = findBlock(key);
+    for(; handle && handle != blocks_.data() + blocks_.size(); ++handle) {
+        if(handle != state.handle) {
+            if(!state.file) {
+                state.file = openFile();
+            }
+            state.block = loadBlock(state.file, *handle, verifyChecksums, true);
+            state.handle = handle;
+        }
+        BlockIterator it(state.block.data, formatVersion_);
+        it.seek(key, sequence);
+        if(!it.valid()) {
+            continue;
+        }
+        if(it.key() != key) {
+            return false;
+        }
+        value = it.value();
+        deleted = it.deleted();
+        return true;
+    }
+    return false;
+}
+
+bool SSTable::mayContain(const std::string& key) const {
+    return filter_.empty() || BloomFilter::mayContain(filter_, key);
+}
+
+LookupResult SSTable::lookup(const std::string& key, uint64_t sequence, bool verifyChecksums) const {
+    ReadState state;
+    return lookup(key, sequence, verifyChecksums, state);
+}
+
+LookupResult SSTable::lookup(std::string_view key, uint64_t sequence, bool verifyChecksums, ReadState& state) const {
+    LookupResult result;
+    if(!filter_.empty()) {
+        if(!BloomFilter::mayContain(filter_, key)) {
+            record(Ticker::BLOOM_FILTER_USEFUL);
+            return result;
+        }
+        record(Ticker::BLOOM_FILTER_POSITIVE);
+    }
+
+    if(formatVersion_ == FORMAT_LEGACY) {
+        return lookupLegacy(key);
+    }
+
+    std::string_view value;
+    bool deleted;
+    if(findEntry(key, sequence, verifyChecksums, state, value, deleted)) {
+        if(deleted) {
+            result.state = LookupResult::State::DELETED;
+        } else {
+            result.state = LookupResult::State::FOUND;
+            result.value.assign(value);
+        }
+        return result;
+    }
+
+    if(!filter_.empty()) {
+        record(Ticker::BLOOM_FILTER_FALSE_POSITIVE);
+    }
+    return result;
+}
+
+bool SSTable::startLookup(const std::string& key, uint64_t sequence, bool verifyChecksums, LookupResult& result, BlockRead& read) const {
+    result = LookupResult();
+    if(!filter_.empty()) {
+        if(!BloomFilter::mayContain(filter_, key)) {
+            record(Ticker::BLOOM_FILTER_USEFUL);
+            return true;
+        }
+        record(Ticker::BLOOM_FILTER_POSITIVE);
+    }
+
+    if(formatVersion_ == FORMAT_LEGACY) {
+        result = lookupLegacy(key);
+        return true;
+    }
+
+    const BlockHandle* handle = findBlock(key);
+    size_t index = handle ? handle - blocks_.data() : blocks_.size();
+    return resumeLookup(key, sequence, verifyChecksums, index, std::nullopt, result, read);
+}
+
+bool SSTable::continueLookup(const std::string& key, uint64_t sequence, bool verifyChecksums, const BlockRead& read, std::string data, LookupResult& result, BlockRead& next) const {
+    std::string_view raw = data;
+    Block block = storeBlock(blocks_[read.block], raw, data, verifyChecksums, true);
+    return resumeLookup(key, sequence, verifyChecksums, read.block, std::move(block), result, next);
+}
+
+// Searches the blocks from index on, block being the one at index when
+// already loaded, until the key is found or a block must be read.
+bool SSTable::resumeLookup(const std::string& key, uint64_t sequence, bool verifyChecksums, size_t index, std::optional<Block> block, LookupResult& result, BlockRead& read) const {
+    std::shared_ptr<const RandomAccessFile> file;
+    for(; index < blocks_.size(); index++, block.reset()) {
+        const BlockHandle& handle = blocks_[index];
+        if(!block) {
+            if(!file) {
+                file = openFile();
+            }
+            std::shared_ptr<const std::string> cached;
+            if(!file->isMapped() && context_.blockCache) {
+                cached = context_.blockCache->lookup(id_, handle.offset);
+                record(cached ? Ticker::BLOCK_CACHE_HIT : Ticker::BLOCK_CACHE_MISS);
+            }
+            if(cached) {
+                block = Block{*cached, cached};
+            } else if(file->isMapped()) {
+                block = loadBlock(file, handle, verifyChecksums, true);
+            } else {
+                read = {file, handle.offset, handle.size, index};
+                return false;
+            }
+        }
+
+        BlockIterator it(block->data, formatVersion_);
+        it.seek(key, sequence);
+        if(!it.valid()) {
+            continue;
+        }
+        if(it.key() == key) {
+            result.state = it.deleted() ? LookupResult::State::DELETED : LookupResult::State::FOUND;
+            if(!it.deleted()) {
+                result.value.assign(it.value());
+            }
+            return true;
+        }
+        break;
+    }
+
+    if(!filter_.empty()) {
+        record(Ticker::BLOOM_FILTER_FALSE_POSITIVE);
+    }
+    return true;
+}
+
+void SSTable::multiLookup(const std::vector<std::string_view>& keys, uint64_t sequence, bool verifyChecksums, std::vector<LookupResult>& results) const {
+    ReadState state;
+    results.resize(keys.size());
+    for(size_t i = 0; i < keys.size(); i++) {
+        results[i] = lookup(keys[i], sequence, verifyChecksums, state);
+    }
+}
+
+std::optional<std::string> SSTable::get(const std::string& key, uint64_t sequence, bool verifyChecksums) const {
+    LookupResult result = lookup(key, sequence, verifyChecksums);
+    if(result.found()) {
+        return std::move(result.value);
+    }
+    return std::nullopt;
+}
+
+LookupResult SSTable::lookupLegacy(std::string_view key) const {
+    LookupResult result;
+    auto it = std::lower_bound(index_.begin(), index_.end(), key,
+        [](const IndexEntry& entry, std::string_view k) {
+            return entry.key < k;
+        });
+    
+    if(it == index_.end() || it->key != key) {
+        if(!filter_.empty()) {
+            record(Ticker::BLOOM_FILTER_FALSE_POSITIVE);
+        }
+        return result;
+    }
+    
+    auto file = openFile();
+    std::string scratch;
+
+    const size_t headerSize = sizeof(uint8_t) + sizeof(uint32_t);
+    std::string_view header = file->read(it->offset, headerSize, scratch);
+    bool deleted = header[0] != 0;
+    uint32_t keySize = decodeFixed32(header.data() + 1);
+
+    if(deleted) {
+        result.state = LookupResult::State::DELETED;
+        return result;
+    }
+
+    uint64_t valueSizeOffset = it->offset + headerSize + keySize;
+    uint32_t valueSize = decodeFixed32(file->read(valueSizeOffset, sizeof(uint32_t), scratch).data());
+    result.state = LookupResult::State::FOUND;
+    result.value.assign(file->read(valueSizeOffset + sizeof(uint32_t), valueSize, scratch));
+    return result;
+}
+
+bool SSTable::contains(const std::string& key) const {
+    if(!mayContain(key)) {
+        return false;
+    }
+
+    if(formatVersion_ != FORMAT_LEGACY) {
+        ReadState state;
+        std::string_view value;
+        bool deleted;
+        return findEntry(key, UINT64_MAX, true, state, value, deleted);
+    }
+
+    auto it = std::lower_bound(index_.begin(), index_.end(), key,
+        [](const IndexEntry& entry, const std::string& k) {
+            return entry.key < k;
+        });
+    
+    return it != index_.end() && it->key == key;
+}
+
+std::vector<SSTableEntry> SSTable::readAll() const {
+    std::vector<SSTableEntry> entries;
+    entries.reserve(numEntries_);
+
+    auto file = openFile();
+    std::string scratch;
+    std::string buffer;
+
+    for(const auto& handle : blocks_) {
+        std::string_view block = blockContents(file->read(handle.offset, handle.size, scratch), buffer, true);
+        BlockIterator it(block, formatVersion_);
+        for(it.seekToFirst(); it.valid(); it.next()) {
+            entries.push_back({std::string(it.key()), std::string(it.value()), it.deleted(), it.sequence()});
+        }
+    }
+    
+    return entries;
+}
+
+class SSTable::TableIterator : public InternalIterator {
+private:
+    const SSTable* table_;
+    bool verifyChecksums_;
+    bool fillCache_;
+    size_t blockIndex_;
+    Block block_;
+    std::optional<BlockIterator> entries_;
+
+    bool loadBlock(size_t index) {
+        entries_.reset();
+        blockIndex_ = index;
+        if(index >= table_->blocks_.size()) {
+            block_ = Block();
+            return false;
+        }
+
+        block_ = table_->loadBlock(table_->blocks_[index], verifyChecksums_, fillCache_);
+        entries_.emplace(block_.data, table_->formatVersion_);
+        return true;
+    }
+
+public:
+    TableIterator(const SSTable* table, bool verifyChecksums, bool fillCache)
+        : table_(table)
+        , verifyChecksums_(verifyChecksums)
+        , fillCache_(fillCache)
+        , blockIndex_(0) {
+    }
+
+    bool valid() const override {
+        return entries_ && entries_->valid();
+    }
+
+    void seekToFirst() override {
+        if(loadBlock(0)) {
+            entries_->seekToFirst();
+        }
+    }
+
+    void seekToLast() override {
+        if(table_->blocks_.empty()) {
+            entries_.reset();
+            return;
+        }
+        loadBlock(table_->blocks_.size() - 1);
+        entries_->seekToLast();
+    }
+
+    void seek(const std::string& target, uint64_t sequence) override {
+        const BlockHandle* handle = table_->findBlock(target);
+        if(!handle) {
+            entries_.reset();
+            return;
+        }
+        loadBlock(handle - table_->blocks_.data());
+        entries_->seek(target, sequence);
+        // Older versions of the target may continue in the following blocks.
+        while(!entries_->valid() && loadBlock(blockIndex_ + 1)) {
+            entries_->seek(target, sequence);
+        }
+    }
+
+    void next() override {
+        entries_->next();
+        if(!entries_->valid() && loadBlock(blockIndex_ + 1)) {
+            entries_->seekToFirst();
+        }
+    }
+
+    void prev() override {
+        entries_->prev();
+        if(entries_->valid()) {
+            return;
+        }
+        if(blockIndex_ == 0 || !loadBlock(blockIndex_ - 1)) {
+            entries_.reset();
+            return;
+        }
+        entries_->seekToLast();
+    }
+
+    std::string_view key() const override {
+        return entries_->key();
+    }
+
+    std::string_view value() const override {
+        return entries_->value();
+    }
+
+    bool deleted() const override {
+        return entries_->deleted();
+    }
+
+    uint64_t sequence() const override {
+        return entries_->sequence();
+    }
+};
+
+std::unique_ptr<InternalIterator> SSTable::newIterator(bool verifyChecksums, bool fillCache) const {
+    return std::make_unique<TableIterator>(this, verifyChecksums, fillCache);
+}
+
+const std::filesystem::path& SSTable::getPath() const {
+    return path_;
+}
+
+size_t SSTable::size() const {
+    return numEntries_;
+}
+
+uint64_t SSTable::getFileSize() const {
+    return fileSize_;
+}
+
+const std::string& SSTable::getSmallestKey() const {
+    return smallestKey_;
+}
+
+const std::string& SSTable::getLargestKey() const {
+    return largestKey_;
+}
+
+uint64_t SSTable::getLargestSequence() const {
+    return largestSequence_;
+}
+
+void SSTable::markObsolete() {
+    obsolete_ = true;
+}
+
 }
\ No newline at end of file
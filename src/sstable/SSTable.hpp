@@ -1,47 +1,164 @@
-#ifndef LSMDB_SSTABLE_HPP
-#define LSMDB_SSTABLE_HPP
-
-#include <filesystem>
-#include <string>
-#include <vector>
-#include <optional>
-#include <cstdint>
-
-namespace lsmdb {
-
-struct SSTableEntry {
-    std::string key;
-    std::string value;
-    bool deleted;
-};
-
-struct IndexEntry {
-    std::string key;
-    uint64_t offset;
-};
-
-class SSTable {
-private:
-    std::filesystem::path path_;
-    std::vector<IndexEntry> index_;
-    
-    void writeEntry(std::ofstream& file, const std::string& key, const std::string& value, bool deleted);
-    void loadIndex();
-
-public:
-    explicit SSTable(const std::filesystem::path& path);
-    
-    static void create(const std::filesystem::path& path, const std::vector<SSTableEntry>& entries);
-    
-    std::optional<std::string> get(const std::string& key) const;
-    bool contains(const std::string& key) const;
-    
-    std::vector<SSTableEntry> readAll() const;
-    
-    const std::filesystem::path& getPath() const;
-    size_t size() const;
-};
-
-}
-
+#ifndef LSMDB_SSTABLE_HPP
+#define LSMDB_SSTABLE_HPP
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <string_view>
+
+#include "Options.hpp"
+#include "Statistics.hpp"
+#include "iterator/LookupResult.hpp"
+
+namespace lsmdb {
+
+// Tables may hold several versions of a key, ordered newest first. Tables
+// written before sequence numbers existed read back with sequence 0.
+struct SSTableEntry {
+    std::string key;
+    std::string value;
+    bool deleted;
+    uint64_t sequence = 0;
+};
+
+class BlockCache;
+class TableCache;
+class RandomAccessFile;
+class InternalIterator;
+
+// Per-DB state shared by every table; all members are optional.
+struct TableContext {
+    Statistics* statistics = nullptr;
+    BlockCache* blockCache = nullptr;
+    TableCache* tableCache = nullptr;
+};
+
+// A data block an SSTable lookup needs read from its file.
+struct BlockRead {
+    std::shared_ptr<const RandomAccessFile> file;
+    uint64_t offset;
+    uint32_t size;
+    size_t block;
+};
+
+struct IndexEntry {
+    std::string key;
+    uint64_t offset;
+};
+
+class SSTable {
+private:
+    class TableIterator;
+
+    struct BlockHandle {
+        std::string lastKey;
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    // A block's bytes plus whatever keeps them alive: a cache entry, a
+    // private copy, or the file mapping the view points into.
+    struct Block {
+        std::string_view data;
+        std::shared_ptr<const void> owner;
+    };
+
+    std::filesystem::path path_;
+    uint32_t formatVersion_;
+    std::vector<IndexEntry> index_;
+    std::vector<BlockHandle> blocks_;
+    std::string smallestKey_;
+    std::string largestKey_;
+    size_t numEntries_;
+    uint64_t largestSequence_;
+    std::string filter_;
+    TableContext context_;
+    uint64_t id_;
+    uint64_t fileSize_;
+    bool obsolete_;
+    
+    void writeEntry(std::ofstream& file, const std::string& key, const std::string& value, bool deleted);
+    void loadIndex();
+    void loadBlockIndex(std::ifstream& file, const char* footer);
+    void loadLegacyIndex(std::ifstream& file);
+
+    // Reads shared by the lookups of a batch: the file, opened on first use,
+    // and the last block read, which sorted keys often land in again.
+    struct ReadState {
+        std::shared_ptr<const RandomAccessFile> file;
+        const BlockHandle* handle = nullptr;
+        Block block;
+    };
+
+    std::shared_ptr<const RandomAccessFile> openFile() const;
+    Block loadBlock(const BlockHandle& handle, bool verifyChecksums, bool fillCache) const;
+    Block loadBlock(const std::shared_ptr<const RandomAccessFile>& file, const BlockHandle& handle, bool verifyChecksums, bool fillCache) const;
+    Block storeBlock(const BlockHandle& handle, std::string_view raw, std::string& scratch, bool verifyChecksums, bool fillCache) const;
+    bool resumeLookup(const std::string& key, uint64_t sequence, bool verifyChecksums, size_t index, std::optional<Block> block, LookupResult& result, BlockRead& read) const;
+    bool storedCompressed(std::string_view raw) const;
+    std::string_view blockContents(std::string_view raw, std::string& buffer, bool verifyChecksums) const;
+    void record(Ticker ticker) const;
+    const BlockHandle* findBlock(std::string_view key) const;
+    bool findEntry(std::string_view key, uint64_t sequence, bool verifyChecksums, ReadState& state, std::string_view& value, bool& deleted) const;
+    LookupResult lookup(std::string_view key, uint64_t sequence, bool verifyChecksums, ReadState& state) const;
+    LookupResult lookupLegacy(std::string_view key) const;
+
+public:
+    explicit SSTable(const std::filesystem::path& path, const TableContext& context = TableContext());
+    ~SSTable();
+
+    SSTable(const SSTable&) = delete;
+    SSTable& operator=(const SSTable&) = delete;
+    
+    // Sorts entries into a new table; sorted input is better streamed
+    // through an SSTableBuilder.
+    static void create(const std::filesystem::path& path, const std::vector<SSTableEntry>& entries, const Options& options = Options());
+    
+    // Newest version of key with a sequence number <= sequence, which may be
+    // a tombstone. Blocks read from the file are checked against their
+    // checksums unless verifyChecksums is false; blocks entering the cache
+    // always are.
+    LookupResult lookup(const std::string& key, uint64_t sequence = UINT64_MAX, bool verifyChecksums = true) const;
+    // lookup() split around its reads, for callers doing the I/O
+    // themselves: startLookup() answers through result and returns true, or
+    // returns false with the block to read in read. continueLookup() goes on
+    // with that block's bytes and answers or asks for the next block the
+    // same way. Blocks in the cache or in a mapped file are used in place.
+    bool startLookup(const std::string& key, uint64_t sequence, bool verifyChecksums, LookupResult& result, BlockRead& read) const;
+    bool continueLookup(const std::string& key, uint64_t sequence, bool verifyChecksums, const BlockRead& read, std::string data, LookupResult& result, BlockRead& next) const;
+    // lookup() for each of keys, which must be sorted, in a single pass: the
+    // file is opened once and blocks are read in file order, each once even
+    // when several keys fall in it. results[i] answers keys[i].
+    void multiLookup(const std::vector<std::string_view>& keys, uint64_t sequence, bool verifyChecksums, std::vector<LookupResult>& results) const;
+    // The value lookup() finds, if it is not a tombstone.
+    std::optional<std::string> get(const std::string& key, uint64_t sequence = UINT64_MAX, bool verifyChecksums = true) const;
+    bool contains(const std::string& key) const;
+    bool mayContain(const std::string& key) const;
+    
+    // Always verifies checksums.
+    std::vector<SSTableEntry> readAll() const;
+
+    // Streams the table one block at a time, tombstones included. The
+    // iterator must not outlive the table. Blocks it reads are added to the
+    // block cache only if fillCache is true.
+    std::unique_ptr<InternalIterator> newIterator(bool verifyChecksums = true, bool fillCache = true) const;
+    
+    const std::filesystem::path& getPath() const;
+    size_t size() const;
+    uint64_t getFileSize() const;
+    const std::string& getSmallestKey() const;
+    const std::string& getLargestKey() const;
+    uint64_t getLargestSequence() const;
+
+    // The file is unlinked once the last reference to this table goes away,
+    // so readers holding an older table set never see it disappear.
+    void markObsolete();
+};
+
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include "SSTableBuilder.hpp"
+#include "BloomFilter.hpp"
+#include "Compression.hpp"
+#include "TableFormat.hpp"
+#include "checksum/CRC32C.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace lsmdb {
+
+namespace {
+
+// Filled blocks are written out in chunks of this size.
+constexpr size_t WRITE_BUFFER_SIZE = 1024 * 1024;
+
+// fsyncs a file or a directory.
+void syncPath(const std::filesystem::path& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        throw std::runtime_error("Failed to open SSTable file for sync");
+    }
+    int result = ::fsync(fd);
+    ::close(fd);
+    if(result != 0) {
+        throw std::runtime_error("Failed to sync SSTable file");
+    }
+}
+
+size_t sharedPrefixLength(std::string_view a, std::string_view b) {
+    size_t length = std::min(a.size(), b.size());
+    size_t i = 0;
+    while(i < length && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+// Shortest key k with start <= k < limit, or start itself if none is
+// shorter. Index keys only need to separate blocks, not name real entries.
+std::string shortestSeparator(const std::string& start, std::string_view limit) {
+    size_t diff = sharedPrefixLength(start, limit);
+    if(diff < start.size() && diff < limit.size()) {
+        uint8_t byte = static_cast<uint8_t>(start[diff]);
+        if(byte < 0xff && byte + 1 < static_cast<uint8_t>(limit[diff])) {
+            std::string separator = start.substr(0, diff + 1);
+            separator[diff] = static_cast<char>(byte + 1);
+            return separator;
+        }
+    }
+    return start;
+}
+
+}
+
+SSTableBuilder::SSTableBuilder(const std::filesystem::path& path, const Options& options)
+    : path_(path)
+    , tmpPath_(path)
+    , blockSize_(options.blockSize)
+    , blockRestartInterval_(std::max<size_t>(options.blockRestartInterval, 1))
+    , bloomBitsPerKey_(options.bloomBitsPerKey)
+    , compression_(options.compression)
+    , offset_(0)
+    , restartCounter_(0)
+    , hasPendingHandle_(false)
+    , lastSequence_(0)
+    , largestSequence_(0)
+    , numEntries_(0)
+    , finished_(false) {
+    // Written under a temporary name and renamed into place, so a crash never
+    // leaves a truncated table behind under a name that would be loaded.
+    tmpPath_ += ".tmp";
+    file_.open(tmpPath_, std::ios::binary | std::ios::trunc);
+    if(!file_) {
+        throw std::runtime_error("Failed to create SSTable file");
+    }
+    buffer_.reserve(WRITE_BUFFER_SIZE);
+}
+
+SSTableBuilder::~SSTableBuilder() {
+    if(!finished_) {
+        file_.close();
+        std::error_code ec;
+        std::filesystem::remove(tmpPath_, ec);
+    }
+}
+
+void SSTableBuilder::write(std::string_view data) {
+    buffer_.append(data);
+    offset_ += data.size();
+    if(buffer_.size() >= WRITE_BUFFER_SIZE) {
+        flushBuffer();
+    }
+}
+
+void SSTableBuilder::flushBuffer() {
+    file_.write(buffer_.data(), buffer_.size());
+    if(!file_) {
+        throw std::runtime_error("Failed to write SSTable file");
+    }
+    buffer_.clear();
+}
+
+void SSTableBuilder::finishBlock() {
+    for(uint32_t restart : restarts_) {
+        putFixed32(block_, restart);
+    }
+    putFixed32(block_, restarts_.size());
+    restarts_.clear();
+
+    std::string_view contents = block_;
+    CompressionType compressionType = CompressionType::NONE;
+    if(compression_ == CompressionType::LZ) {
+        LZCodec::compress(block_, compressed_);
+        if(compressed_.size() < block_.size() - block_.size() / 8) {
+            contents = compressed_;
+            compressionType = CompressionType::LZ;
+        }
+    }
+
+    pendingHandle_ = {lastKey_, offset_, static_cast<uint32_t>(contents.size() + BLOCK_TRAILER_SIZE)};
+    hasPendingHandle_ = true;
+    write(contents);
+    // The trailer is the compression type, then a checksum of the block as
+    // stored, type included.
+    char type = static_cast<char>(compressionType);
+    uint32_t checksum = CRC32C::extend(CRC32C::value(contents), std::string_view(&type, 1));
+    std::string trailer(1, type);
+    putFixed32(trailer, CRC32C::mask(checksum));
+    write(trailer);
+    block_.clear();
+}
+
+void SSTableBuilder::add(std::string_view key, std::string_view value, bool deleted, uint64_t sequence) {
+    if(numEntries_ > 0 && (key < lastKey_ || (key == lastKey_ && sequence > lastSequence_))) {
+        throw std::runtime_error("SSTable entries added out of order");
+    }
+
+    if(numEntries_ == 0) {
+        smallestKey_.assign(key);
+    }
+    if(hasPendingHandle_) {
+        // Versions of one key may straddle blocks; the earlier block then
+        // keeps the key itself.
+        blocks_.push_back(std::move(pendingHandle_));
+        blocks_.back().lastKey = shortestSeparator(blocks_.back().lastKey, key);
+        hasPendingHandle_ = false;
+    }
+
+    // Keys share their prefix with the previous key, except every
+    // blockRestartInterval entries where the full key restarts the chain.
+    size_t shared = 0;
+    if(block_.empty() || restartCounter_ >= blockRestartInterval_) {
+        restarts_.push_back(block_.size());
+        restartCounter_ = 0;
+    } else {
+        shared = sharedPrefixLength(lastKey_, key);
+    }
+    restartCounter_++;
+
+    putVarint(block_, shared);
+    putVarint(block_, key.size() - shared);
+    putVarint(block_, value.size());
+    block_.push_back(deleted ? 1 : 0);
+    putFixed64(block_, sequence);
+    block_.append(key.substr(shared));
+    block_.append(value);
+
+    // The filter holds each key once, however many versions it has.
+    if(numEntries_ == 0 || key != lastKey_) {
+        if(bloomBitsPerKey_ > 0) {
+            keyHashes_.push_back(BloomFilter::hash(key));
+        }
+        lastKey_.assign(key);
+    }
+    lastSequence_ = sequence;
+    largestSequence_ = std::max(largestSequence_, sequence);
+    numEntries_++;
+
+    if(block_.size() >= blockSize_) {
+        finishBlock();
+    }
+}
+
+void SSTableBuilder::finish() {
+    if(!block_.empty()) {
+        finishBlock();
+    }
+    // The last block keeps its full key, which is the table's largest.
+    if(hasPendingHandle_) {
+        blocks_.push_back(std::move(pendingHandle_));
+        hasPendingHandle_ = false;
+    }
+
+    uint64_t filterOffset = offset_;
+    std::string filter;
+    if(bloomBitsPerKey_ > 0) {
+        filter = BloomFilter::buildFromHashes(keyHashes_, bloomBitsPerKey_);
+        putFixed32(filter, CRC32C::mask(CRC32C::value(filter)));
+        write(filter);
+    }
+
+    // One index entry per block, keyed by the block's last key.
+    std::string index;
+    putFixed32(index, blocks_.size());
+    for(const auto& handle : blocks_) {
+        putFixed32(index, handle.lastKey.size());
+        index.append(handle.lastKey);
+        putFixed64(index, handle.offset);
+        putFixed32(index, handle.size);
+    }
+    putFixed32(index, smallestKey_.size());
+    index.append(smallestKey_);
+    putFixed64(index, numEntries_);
+    putFixed64(index, largestSequence_);
+    putFixed32(index, CRC32C::mask(CRC32C::value(index)));
+
+    uint64_t indexOffset = offset_;
+    write(index);
+
+    std::string footer;
+    putFixed64(footer, filterOffset);
+    putFixed64(footer, filter.size());
+    putFixed64(footer, indexOffset);
+    putFixed64(footer, index.size());
+    putFixed32(footer, FORMAT_CHECKSUMMED);
+    putFixed64(footer, TABLE_MAGIC);
+    write(footer);
+
+    flushBuffer();
+    file_.close();
+    if(!file_) {
+        throw std::runtime_error("Failed to write SSTable file");
+    }
+    // Durable before it can be listed in the MANIFEST and the log holding
+    // its writes retired.
+    syncPath(tmpPath_);
+    std::filesystem::rename(tmpPath_, path_);
+    syncPath(path_.parent_path().empty() ? std::filesystem::path(".") : path_.parent_path());
+    finished_ = true;
+}
+
+uint64_t SSTableBuilder::numEntries() const {
+    return numEntries_;
+}
+
+uint64_t SSTableBuilder::fileSize() const {
+    return offset_ + block_.size();
+}
+
+}
\ No newline at end of file
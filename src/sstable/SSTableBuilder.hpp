@@ -0,0 +1,76 @@
+#ifndef LSMDB_SSTABLEBUILDER_HPP
+#define LSMDB_SSTABLEBUILDER_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Options.hpp"
+
+namespace lsmdb {
+
+// Writes a table from entries added in table order: key ascending, then
+// sequence number descending. Blocks go to disk as they fill, so memory
+// stays bounded by the write buffer plus the index and one filter hash per
+// key. The table appears under its path only once finish() succeeds; a
+// builder destroyed before that removes what it wrote.
+class SSTableBuilder {
+private:
+    struct BlockHandle {
+        std::string lastKey;
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    std::filesystem::path path_;
+    std::filesystem::path tmpPath_;
+    std::ofstream file_;
+    size_t blockSize_;
+    size_t blockRestartInterval_;
+    size_t bloomBitsPerKey_;
+    CompressionType compression_;
+
+    std::string block_;
+    std::string compressed_;
+    std::string buffer_;
+    uint64_t offset_;
+    std::vector<uint32_t> restarts_;
+    size_t restartCounter_;
+    std::vector<BlockHandle> blocks_;
+    // The last finished block waits for the next block's first key, so its
+    // index key can be shortened to anything between the two.
+    BlockHandle pendingHandle_;
+    bool hasPendingHandle_;
+    std::vector<uint32_t> keyHashes_;
+    std::string smallestKey_;
+    std::string lastKey_;
+    uint64_t lastSequence_;
+    uint64_t largestSequence_;
+    uint64_t numEntries_;
+    bool finished_;
+
+    void write(std::string_view data);
+    void flushBuffer();
+    void finishBlock();
+
+public:
+    SSTableBuilder(const std::filesystem::path& path, const Options& options);
+    ~SSTableBuilder();
+
+    SSTableBuilder(const SSTableBuilder&) = delete;
+    SSTableBuilder& operator=(const SSTableBuilder&) = delete;
+
+    void add(std::string_view key, std::string_view value, bool deleted, uint64_t sequence = 0);
+    void finish();
+
+    uint64_t numEntries() const;
+    // Bytes of entries added so far, whether or not they reached the file.
+    uint64_t fileSize() const;
+};
+
+}
+
+#endif
\ No newline at end of file
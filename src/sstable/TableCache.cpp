@@ -0,0 +1,21 @@
+#include "TableCache.hpp"
+
+namespace lsmdb {
+
+TableCache::TableCache(size_t maxOpenFiles, bool useMmap)
+    : cache_(maxOpenFiles)
+    , useMmap_(useMmap) {
+}
+
+std::shared_ptr<const RandomAccessFile> TableCache::open(uint64_t tableId, const std::filesystem::path& path) {
+    if(auto file = cache_.lookup(tableId)) {
+        return file;
+    }
+    return cache_.insert(tableId, std::make_shared<const RandomAccessFile>(path, useMmap_), 1);
+}
+
+void TableCache::evict(uint64_t tableId) {
+    cache_.erase(tableId);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef LSMDB_TABLECACHE_HPP
+#define LSMDB_TABLECACHE_HPP
+
+#include "RandomAccessFile.hpp"
+#include "cache/LRUCache.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+namespace lsmdb {
+
+// Bounded set of open SSTable files. The least recently used handle is
+// closed once more than maxOpenFiles are open; a table evicted while a read
+// is in flight keeps its handle until that read finishes.
+class TableCache {
+private:
+    LRUCache<uint64_t, RandomAccessFile> cache_;
+    bool useMmap_;
+
+public:
+    TableCache(size_t maxOpenFiles, bool useMmap);
+
+    std::shared_ptr<const RandomAccessFile> open(uint64_t tableId, const std::filesystem::path& path);
+    void evict(uint64_t tableId);
+};
+
+}
+
+#endif
\ No newline at end of file
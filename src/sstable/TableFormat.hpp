@@ -0,0 +1,31 @@
+#ifndef LSMDB_TABLEFORMAT_HPP
+#define LSMDB_TABLEFORMAT_HPP
+
+#include "util/Coding.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lsmdb {
+
+// Block-based tables end in a fixed-size footer. Files written before the
+// format existed end in a bare index offset and never carry this magic.
+constexpr uint64_t TABLE_MAGIC = 0x4c534d4442535354ULL;
+constexpr uint32_t FORMAT_LEGACY = 0;
+constexpr uint32_t FORMAT_BLOCK_BASED = 1;
+// Entries carry a sequence number and the index the largest one.
+constexpr uint32_t FORMAT_SEQUENCED = 2;
+// Every data block is followed by a byte naming its CompressionType.
+constexpr uint32_t FORMAT_COMPRESSED = 3;
+// Data blocks store keys as deltas against the previous key and end with
+// the offsets of their restart points, entries that hold the full key.
+constexpr uint32_t FORMAT_PREFIX_KEYS = 4;
+// Data blocks, the filter and the index end with a masked CRC32C.
+constexpr uint32_t FORMAT_CHECKSUMMED = 5;
+// Compression type byte plus checksum.
+constexpr size_t BLOCK_TRAILER_SIZE = 1 + sizeof(uint32_t);
+constexpr size_t FOOTER_SIZE = 4 * sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint64_t);
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef LSMDB_CODING_HPP
+#define LSMDB_CODING_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace lsmdb {
+
+// Encoders shared by the on-disk formats. Fixed-width integers are stored
+// in host byte order.
+inline void putFixed32(std::string& dst, uint32_t value) {
+    dst.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void putFixed64(std::string& dst, uint64_t value) {
+    dst.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline uint32_t decodeFixed32(const char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t decodeFixed64(const char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline void putVarint(std::string& dst, uint64_t value) {
+    while(value >= 0x80) {
+        dst.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    dst.push_back(static_cast<char>(value));
+}
+
+inline bool getVarint(const char*& p, const char* limit, uint64_t& value) {
+    value = 0;
+    for(int shift = 0; shift <= 63 && p < limit; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "Version.hpp"
+
+#include <algorithm>
+
+namespace lsmdb {
+
+std::vector<TableFile> TableSet::overlapping(int level, const std::string& smallest, const std::string& largest) const {
+    std::vector<TableFile> result;
+    for(const auto& file : levels[level]) {
+        if(file.table->getLargestKey() < smallest || file.table->getSmallestKey() > largest) {
+            continue;
+        }
+        result.push_back(file);
+    }
+    return result;
+}
+
+const TableFile* TableSet::findTable(int level, const std::string& key) const {
+    const auto& files = levels[level];
+    auto it = std::lower_bound(files.begin(), files.end(), key,
+        [](const TableFile& file, const std::string& k) {
+            return file.table->getLargestKey() < k;
+        });
+
+    if(it == files.end() || it->table->getSmallestKey() > key) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+uint64_t TableSet::levelBytes(int level) const {
+    uint64_t total = 0;
+    for(const auto& file : levels[level]) {
+        total += file.table->getFileSize();
+    }
+    return total;
+}
+
+size_t TableSet::totalTables() const {
+    size_t total = 0;
+    for(const auto& files : levels) {
+        total += files.size();
+    }
+    return total;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef LSMDB_VERSION_HPP
+#define LSMDB_VERSION_HPP
+
+#include "sstable/SSTable.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lsmdb {
+
+struct TableFile {
+    uint64_t number;
+    std::shared_ptr<SSTable> table;
+};
+
+// Immutable version of the live tables; flushes and compactions install a
+// new one instead of changing it. Level 0 holds flushed tables ordered
+// oldest to newest and may overlap; every deeper level is sorted by
+// smallest key and its tables cover disjoint key ranges.
+struct TableSet {
+    static constexpr int NUM_LEVELS = 7;
+
+    std::array<std::vector<TableFile>, NUM_LEVELS> levels;
+
+    std::vector<TableFile> overlapping(int level, const std::string& smallest, const std::string& largest) const;
+    const TableFile* findTable(int level, const std::string& key) const;
+    uint64_t levelBytes(int level) const;
+    size_t totalTables() const;
+};
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "VersionEdit.hpp"
+#include "util/Coding.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace lsmdb {
+
+namespace {
+
+enum class Tag : uint8_t {
+    NEXT_FILE_NUMBER = 1,
+    ADD_TABLE = 2,
+    REMOVE_TABLE = 3
+};
+
+template <typename T>
+T decodeFixed(std::string_view& src) {
+    T value;
+    if(src.size() < sizeof(value)) {
+        throw std::runtime_error("Corrupt version edit");
+    }
+    std::memcpy(&value, src.data(), sizeof(value));
+    src.remove_prefix(sizeof(value));
+    return value;
+}
+
+int decodeLevel(std::string_view& src) {
+    uint32_t level = decodeFixed<uint32_t>(src);
+    if(level >= TableSet::NUM_LEVELS) {
+        throw std::runtime_error("Corrupt version edit");
+    }
+    return static_cast<int>(level);
+}
+
+}
+
+void VersionEdit::encode(std::string& dst) const {
+    if(nextFileNumber_) {
+        dst.push_back(static_cast<char>(Tag::NEXT_FILE_NUMBER));
+        putFixed64(dst, *nextFileNumber_);
+    }
+    for(const auto& [level, number] : removedTables_) {
+        dst.push_back(static_cast<char>(Tag::REMOVE_TABLE));
+        putFixed32(dst, level);
+        putFixed64(dst, number);
+    }
+    for(const auto& [level, file] : addedTables_) {
+        dst.push_back(static_cast<char>(Tag::ADD_TABLE));
+        putFixed32(dst, level);
+        putFixed64(dst, file.number);
+    }
+}
+
+VersionEdit VersionEdit::decode(std::string_view src) {
+    VersionEdit edit;
+    while(!src.empty()) {
+        Tag tag = static_cast<Tag>(src.front());
+        src.remove_prefix(1);
+        if(tag == Tag::NEXT_FILE_NUMBER) {
+            edit.setNextFileNumber(decodeFixed<uint64_t>(src));
+        } else if(tag == Tag::ADD_TABLE) {
+            int level = decodeLevel(src);
+            edit.addTable(level, {decodeFixed<uint64_t>(src), nullptr});
+        } else if(tag == Tag::REMOVE_TABLE) {
+            int level = decodeLevel(src);
+            edit.removeTable(level, decodeFixed<uint64_t>(src));
+        } else {
+            throw std::runtime_error("Corrupt version edit");
+        }
+    }
+    return edit;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef LSMDB_VERSIONEDIT_HPP
+#define LSMDB_VERSIONEDIT_HPP
+
+#include "Version.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lsmdb {
+
+// Change from one version of the table set to the next, as logged to the
+// MANIFEST. Only file numbers are stored; decoded edits carry no tables.
+class VersionEdit {
+private:
+    std::optional<uint64_t> nextFileNumber_;
+    std::vector<std::pair<int, TableFile>> addedTables_;
+    std::vector<std::pair<int, uint64_t>> removedTables_;
+
+public:
+    void setNextFileNumber(uint64_t number) { nextFileNumber_ = number; }
+    void addTable(int level, const TableFile& file) { addedTables_.push_back({level, file}); }
+    void removeTable(int level, uint64_t number) { removedTables_.push_back({level, number}); }
+
+    const std::optional<uint64_t>& nextFileNumber() const { return nextFileNumber_; }
+    const std::vector<std::pair<int, TableFile>>& addedTables() const { return addedTables_; }
+    const std::vector<std::pair<int, uint64_t>>& removedTables() const { return removedTables_; }
+
+    void encode(std::string& dst) const;
+    static VersionEdit decode(std::string_view src);
+};
+
+}
+
+#endif
\ No newline at end of file
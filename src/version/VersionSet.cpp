@@ -0,0 +1,132 @@
+#include "VersionSet.hpp"
+#include "wal/WAL.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lsmdb {
+
+namespace {
+
+// Above this size the MANIFEST is rewritten as a single edit.
+constexpr size_t MAX_MANIFEST_SIZE = 4 * 1024 * 1024;
+
+}
+
+VersionSet::VersionSet(const std::filesystem::path& dbPath)
+    : path_(dbPath / "MANIFEST")
+    , current_(std::make_shared<const TableSet>())
+    , nextFileNumber_(0) {
+}
+
+VersionSet::~VersionSet() = default;
+
+std::optional<VersionSet::Manifest> VersionSet::recover() const {
+    if(!std::filesystem::exists(path_)) {
+        return std::nullopt;
+    }
+
+    Manifest manifest;
+    WAL log(path_);
+    for(const auto& record : log.recover()) {
+        if(record.type != RecordType::VERSION_EDIT) {
+            throw std::runtime_error("Corrupt MANIFEST");
+        }
+        VersionEdit edit = VersionEdit::decode(record.value);
+        if(edit.nextFileNumber()) {
+            manifest.nextFileNumber = std::max(manifest.nextFileNumber, *edit.nextFileNumber());
+        }
+        for(const auto& [level, number] : edit.removedTables()) {
+            auto& numbers = manifest.levels[level];
+            numbers.erase(std::remove(numbers.begin(), numbers.end(), number), numbers.end());
+        }
+        for(const auto& [level, file] : edit.addedTables()) {
+            manifest.levels[level].push_back(file.number);
+        }
+    }
+    return manifest;
+}
+
+void VersionSet::writeSnapshot(const TableSet& tables) {
+    VersionEdit edit;
+    edit.setNextFileNumber(nextFileNumber_);
+    for(int level = 0; level < TableSet::NUM_LEVELS; level++) {
+        for(const auto& file : tables.levels[level]) {
+            edit.addTable(level, file);
+        }
+    }
+    std::string contents;
+    edit.encode(contents);
+    std::string record;
+    WAL::encodeRecord(record, RecordType::VERSION_EDIT, std::string(), contents);
+
+    // The old MANIFEST stays in place until the new one is complete.
+    auto tmpPath = path_;
+    tmpPath += ".tmp";
+    std::filesystem::remove(tmpPath);
+    {
+        WAL tmp(tmpPath);
+        tmp.append(record);
+        tmp.sync();
+    }
+    std::filesystem::rename(tmpPath, path_);
+    WAL::syncDirectory(path_.parent_path().empty() ? std::filesystem::path(".") : path_.parent_path());
+    manifest_ = std::make_unique<WAL>(path_);
+}
+
+void VersionSet::open(std::shared_ptr<const TableSet> tables, uint64_t nextFileNumber) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nextFileNumber_ = nextFileNumber;
+    writeSnapshot(*tables);
+    current_.store(std::move(tables), std::memory_order_release);
+}
+
+std::shared_ptr<const TableSet> VersionSet::current() const {
+    return current_.load(std::memory_order_acquire);
+}
+
+void VersionSet::logAndApply(const VersionEdit& edit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(edit.nextFileNumber()) {
+        nextFileNumber_ = std::max(nextFileNumber_, *edit.nextFileNumber());
+    }
+
+    std::string contents;
+    edit.encode(contents);
+    std::string record;
+    WAL::encodeRecord(record, RecordType::VERSION_EDIT, std::string(), contents);
+    manifest_->append(record);
+    manifest_->sync();
+
+    auto next = apply(*current(), edit);
+    if(manifest_->size() > MAX_MANIFEST_SIZE) {
+        writeSnapshot(*next);
+    }
+    current_.store(std::move(next), std::memory_order_release);
+}
+
+std::shared_ptr<const TableSet> VersionSet::apply(const TableSet& base, const VersionEdit& edit) {
+    auto next = std::make_shared<TableSet>(base);
+
+    for(const auto& [level, number] : edit.removedTables()) {
+        auto& files = next->levels[level];
+        files.erase(std::remove_if(files.begin(), files.end(), [number](const TableFile& file) {
+            return file.number == number;
+        }), files.end());
+    }
+
+    for(const auto& [level, file] : edit.addedTables()) {
+        next->levels[level].push_back(file);
+    }
+
+    // Level 0 keeps install order, newest last.
+    for(int level = 1; level < TableSet::NUM_LEVELS; level++) {
+        std::sort(next->levels[level].begin(), next->levels[level].end(), [](const TableFile& a, const TableFile& b) {
+            return a.table->getSmallestKey() < b.table->getSmallestKey();
+        });
+    }
+
+    return next;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef LSMDB_VERSIONSET_HPP
+#define LSMDB_VERSIONSET_HPP
+
+#include "Version.hpp"
+#include "VersionEdit.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace lsmdb {
+
+class WAL;
+
+// Owns the current version of the table set and the MANIFEST, a log of the
+// edits that produced it. Readers take the current version with a single
+// atomic load and keep it alive for as long as they use it.
+class VersionSet {
+public:
+    // Live table numbers of each level in the order they were installed.
+    struct Manifest {
+        std::array<std::vector<uint64_t>, TableSet::NUM_LEVELS> levels;
+        uint64_t nextFileNumber = 0;
+    };
+
+private:
+    std::filesystem::path path_;
+    std::unique_ptr<WAL> manifest_;
+    std::atomic<std::shared_ptr<const TableSet>> current_;
+    uint64_t nextFileNumber_;
+    std::mutex mutex_;
+
+    void writeSnapshot(const TableSet& tables);
+
+public:
+    explicit VersionSet(const std::filesystem::path& dbPath);
+    ~VersionSet();
+
+    VersionSet(const VersionSet&) = delete;
+    VersionSet& operator=(const VersionSet&) = delete;
+
+    // Replays the MANIFEST, or returns nullopt if the DB has none yet.
+    std::optional<Manifest> recover() const;
+
+    // Starts a new MANIFEST holding just tables and makes them current.
+    void open(std::shared_ptr<const TableSet> tables, uint64_t nextFileNumber);
+
+    std::shared_ptr<const TableSet> current() const;
+
+    // Durably logs edit, then installs the version it yields on top of the
+    // current one. Safe to call from several threads.
+    void logAndApply(const VersionEdit& edit);
+
+    static std::shared_ptr<const TableSet> apply(const TableSet& base, const VersionEdit& edit);
+};
+
+}
+
+#endif
\ No newline at end of file
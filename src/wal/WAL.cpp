@@ -1,100 +1,266 @@
-#include "Wal.hpp"
-#include <cstring>
-
-namespace lsmdb {
-
-WAL::WAL(const std::filesystem::path& path) 
-    : path_(path)
-    , fileSize_(0) {
-    file_.open(path_, std::ios::binary | std::ios::app);
-    if (!file_) {
-        throw std::runtime_error("Failed to open WAL file");
-    }
-    fileSize_ = std::filesystem::file_size(path_);
-}
-
-WAL::~WAL() {
-    if (file_.is_open()) {
-        file_.close();
-    }
-}
-
-void WAL::writeRecord(RecordType type, const std::string& key, const std::string& value) {
-    uint8_t recordType = static_cast<uint8_t>(type);
-    uint32_t keySize = key.size();
-    uint32_t valueSize = value.size();
-    
-    file_.write(reinterpret_cast<const char*>(&recordType), sizeof(recordType));
-    file_.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
-    file_.write(key.data(), keySize);
-    file_.write(reinterpret_cast<const char*>(&valueSize), sizeof(valueSize));
-    file_.write(value.data(), valueSize);
-    
-    fileSize_ += sizeof(recordType) + sizeof(keySize) + keySize + sizeof(valueSize) + valueSize;
-}
-
-void WAL::logPut(const std::string& key, const std::string& value) {
-    writeRecord(RecordType::PUT, key, value);
-}
-
-void WAL::logDelete(const std::string& key) {
-    writeRecord(RecordType::DELETE, key, "");
-}
-
-void WAL::sync() {
-    file_.flush();
-    // file_.sync();
-}
-
-void WAL::clear() {
-    file_.close();
-    std::filesystem::remove(path_);
-    file_.open(path_, std::ios::binary | std::ios::app);
-    fileSize_ = 0;
-}
-
-std::vector<WalRecord> WAL::recover() {
-    std::vector<WalRecord> records;
-    std::ifstream recoveryFile(path_, std::ios::binary);
-    
-    if (!recoveryFile) {
-        return records;
-    }
-    
-    while (recoveryFile.peek() != EOF) {
-        uint8_t recordType;
-        uint32_t keySize;
-        uint32_t valueSize;
-        
-        recoveryFile.read(reinterpret_cast<char*>(&recordType), sizeof(recordType));
-        if (recoveryFile.gcount() != sizeof(recordType)) break;
-        
-        recoveryFile.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
-        if (recoveryFile.gcount() != sizeof(keySize)) break;
-        
-        std::string key(keySize, '\0');
-        recoveryFile.read(&key[0], keySize);
-        if (recoveryFile.gcount() != static_cast<std::streamsize>(keySize)) break;
-        
-        recoveryFile.read(reinterpret_cast<char*>(&valueSize), sizeof(valueSize));
-        if (recoveryFile.gcount() != sizeof(valueSize)) break;
-        
-        std::string value(valueSize, '\0');
-        recoveryFile.read(&value[0], valueSize);
-        if (recoveryFile.gcount() != static_cast<std::streamsize>(valueSize)) break;
-        
-        records.push_back({
-            static_cast<RecordType>(recordType),
-            std::move(key),
-            std::move(value)
-        });
-    }
-    
-    return records;
-}
-
-size_t WAL::size() const {
-    return fileSize_;
-}
-
+#include "WAL.hpp"
+#include "checksum/CRC32C.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace lsmdb {
+
+WAL::WAL(const std::filesystem::path& path, uint64_t logNumber, bool recycled) 
+    : path_(path)
+    , logNumber_(logNumber)
+    , fd_(-1)
+    , fileSize_(0) {
+    // Writes go to explicit offsets, so a recycled file keeps its blocks
+    // and syncing it does not have to update its size.
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open WAL file");
+    }
+    if (!recycled) {
+        fileSize_ = std::filesystem::file_size(path_);
+    }
+}
+
+WAL::~WAL() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+uint32_t WAL::seedFor(uint64_t logNumber) {
+    if (logNumber == 0) {
+        return 0;
+    }
+    return CRC32C::value(std::string_view(reinterpret_cast<const char*>(&logNumber), sizeof(logNumber)));
+}
+
+void WAL::encodeRecord(std::string& dst, RecordType type, const std::string& key, const std::string& value, uint64_t logNumber) {
+    uint8_t recordType = static_cast<uint8_t>(type) | CHECKSUM_FLAG | (logNumber != 0 ? LOG_NUMBER_FLAG : 0);
+    uint32_t checksum = 0;
+    uint32_t keySize = key.size();
+    uint32_t valueSize = value.size();
+    
+    size_t start = dst.size();
+    dst.append(reinterpret_cast<const char*>(&recordType), sizeof(recordType));
+    dst.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    dst.append(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+    dst.append(key);
+    dst.append(reinterpret_cast<const char*>(&valueSize), sizeof(valueSize));
+    dst.append(value);
+    
+    // The checksum covers the whole record except itself.
+    std::string_view record(dst.data() + start, dst.size() - start);
+    checksum = CRC32C::extend(CRC32C::extend(seedFor(logNumber), record.substr(0, 1)), record.substr(1 + sizeof(checksum)));
+    checksum = CRC32C::mask(checksum);
+    std::memcpy(dst.data() + start + 1, &checksum, sizeof(checksum));
+}
+
+void WAL::append(std::string_view records) {
+    const char* p = records.data();
+    size_t left = records.size();
+    while (left > 0) {
+        ssize_t written = ::pwrite(fd_, p, left, fileSize_ + (records.size() - left));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to write WAL file");
+        }
+        p += written;
+        left -= static_cast<size_t>(written);
+    }
+    fileSize_ += records.size();
+}
+
+void WAL::logPut(const std::string& key, const std::string& value) {
+    std::string record;
+    encodeRecord(record, RecordType::PUT, key, value, logNumber_);
+    append(record);
+}
+
+void WAL::logDelete(const std::string& key) {
+    std::string record;
+    encodeRecord(record, RecordType::DELETE, key, "", logNumber_);
+    append(record);
+}
+
+void WAL::sync() {
+    std::lock_guard<std::mutex> lock(fileMutex_);
+#if defined(__linux__)
+    int result = ::fdatasync(fd_);
+#else
+    int result = ::fsync(fd_);
+#endif
+    if (result != 0) {
+        throw std::runtime_error("Failed to sync WAL file");
+    }
+}
+
+void WAL::syncDirectory(const std::filesystem::path& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open DB directory");
+    }
+    int result = ::fsync(fd);
+    ::close(fd);
+    if (result != 0) {
+        throw std::runtime_error("Failed to sync DB directory");
+    }
+}
+
+void WAL::preallocate(size_t bytes) {
+#if defined(__linux__)
+    // Best effort: the size is left alone, so nothing changes for readers.
+    ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, bytes);
+#else
+    (void)bytes;
+#endif
+}
+
+namespace {
+
+// Keeps the log mapped while its records are replayed.
+struct Mapping {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    ~Mapping() {
+        if (data) {
+            ::munmap(const_cast<char*>(data), size);
+        }
+    }
+};
+
+}
+
+// Parses the record at next and advances next past it; returns false if
+// the record is torn or fails its checksum. Sizes are checked against what
+// is left of the file before they are trusted. Once a record tagged with
+// the log number is seen, numberedOnly is set and untagged ones end the
+// log too: past the end of a recycled file's new records, stale bytes could
+// pass for a record of the unchecked legacy format.
+bool WAL::parseRecord(const char*& next, const char* limit, WalRecordView& record, bool& numberedOnly) const {
+    const char* start = next;
+    const char* p = next;
+    auto need = [&](size_t n) {
+        return static_cast<size_t>(limit - p) >= n;
+    };
+
+    if (!need(sizeof(uint8_t))) return false;
+    uint8_t recordType = static_cast<uint8_t>(*p++);
+    // No record type is 0: the log ends where a preallocated or zeroed
+    // region starts.
+    if ((recordType & ~(CHECKSUM_FLAG | LOG_NUMBER_FLAG)) == 0) return false;
+
+    // Records written before checksums existed lack the flag and the field.
+    bool checksummed = (recordType & CHECKSUM_FLAG) != 0;
+    bool numbered = (recordType & LOG_NUMBER_FLAG) != 0;
+    if (numbered ? !checksummed || logNumber_ == 0 : numberedOnly) return false;
+    uint32_t checksum = 0;
+    if (checksummed) {
+        if (!need(sizeof(checksum))) return false;
+        std::memcpy(&checksum, p, sizeof(checksum));
+        p += sizeof(checksum);
+    }
+    const char* checked = p;
+
+    uint32_t keySize;
+    if (!need(sizeof(keySize))) return false;
+    std::memcpy(&keySize, p, sizeof(keySize));
+    p += sizeof(keySize);
+    if (!need(keySize)) return false;
+    record.key = std::string_view(p, keySize);
+    p += keySize;
+
+    uint32_t valueSize;
+    if (!need(sizeof(valueSize))) return false;
+    std::memcpy(&valueSize, p, sizeof(valueSize));
+    p += sizeof(valueSize);
+    if (!need(valueSize)) return false;
+    record.value = std::string_view(p, valueSize);
+    p += valueSize;
+
+    // A record that fails its checksum ends the log like a torn one:
+    // nothing after it can be trusted to be in order.
+    if (checksummed) {
+        uint32_t seed = numbered ? seedFor(logNumber_) : 0;
+        uint32_t actual = CRC32C::extend(CRC32C::extend(seed, std::string_view(start, 1)), std::string_view(checked, p - checked));
+        if (actual != CRC32C::unmask(checksum)) return false;
+    }
+
+    record.type = static_cast<RecordType>(recordType & ~(CHECKSUM_FLAG | LOG_NUMBER_FLAG));
+    numberedOnly = numberedOnly || numbered;
+    next = p;
+    return true;
+}
+
+void WAL::replay(size_t batchSize, const std::function<void(const std::vector<WalRecordView>&)>& handler) {
+    Mapping mapping;
+    if (fileSize_ > 0) {
+        int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open WAL file");
+        }
+        void* data = ::mmap(nullptr, fileSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Failed to map WAL file");
+        }
+        ::madvise(data, fileSize_, MADV_SEQUENTIAL);
+        mapping.data = static_cast<const char*>(data);
+        mapping.size = fileSize_;
+    }
+
+    const char* p = mapping.data;
+    const char* limit = mapping.data + mapping.size;
+    std::vector<WalRecordView> batch;
+    batch.reserve(std::min<size_t>(batchSize, 4096));
+    WalRecordView record;
+    bool numberedOnly = false;
+    while (p < limit && parseRecord(p, limit, record, numberedOnly)) {
+        batch.push_back(record);
+        if (batch.size() >= batchSize) {
+            handler(batch);
+            batch.clear();
+        }
+    }
+    if (!batch.empty()) {
+        handler(batch);
+    }
+    size_t validSize = p ? p - mapping.data : 0;
+    
+    // Drop a torn tail so records appended from now on stay reachable.
+    if (validSize < fileSize_) {
+        std::lock_guard<std::mutex> lock(fileMutex_);
+        if (::ftruncate(fd_, validSize) != 0) {
+            throw std::runtime_error("Failed to truncate WAL file");
+        }
+        fileSize_ = validSize;
+    }
+}
+
+std::vector<WalRecord> WAL::recover() {
+    std::vector<WalRecord> records;
+    replay(4096, [&](const std::vector<WalRecordView>& batch) {
+        for (const auto& record : batch) {
+            records.push_back({record.type, std::string(record.key), std::string(record.value)});
+        }
+    });
+    return records;
+}
+
+uint64_t WAL::logNumber() const {
+    return logNumber_;
+}
+
+size_t WAL::size() const {
+    return fileSize_;
+}
+
 }
\ No newline at end of file
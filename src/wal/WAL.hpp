@@ -1,48 +1,96 @@
-#ifndef LSMDB_WAL_HPP
-#define LSMDB_WAL_HPP
-
-#include <filesystem>
-#include <fstream>
-#include <string>
-#include <vector>
-
-namespace lsmdb {
-
-enum class RecordType : uint8_t {
-    PUT = 1,
-    DELETE = 2
-};
-
-struct WalRecord {
-    RecordType type;
-    std::string key;
-    std::string value;
-};
-
-class WAL {
-private:
-    std::filesystem::path path_;
-    std::ofstream file_;
-    size_t fileSize_;
-
-    void writeRecord(RecordType type, const std::string& key, const std::string& value);
-
-public:
-    explicit WAL(const std::filesystem::path& path);
-    ~WAL();
-
-    WAL(const WAL&) = delete;
-    WAL& operator=(const WAL&) = delete;
-
-    void logPut(const std::string& key, const std::string& value);
-    void logDelete(const std::string& key);
-    void sync();
-    void clear();
-
-    std::vector<WalRecord> recover();
-    size_t size() const;
-};
-
-}
-
+#ifndef LSMDB_WAL_HPP
+#define LSMDB_WAL_HPP
+
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lsmdb {
+
+enum class RecordType : uint8_t {
+    PUT = 1,
+    DELETE = 2,
+    // Value holds an encoded WriteBatch; the key is empty.
+    BATCH = 3,
+    // Like BATCH, with the key holding the sequence number of the batch's
+    // first record as 8 little-endian bytes.
+    SEQUENCED_BATCH = 4,
+    // Value holds an encoded VersionEdit; only found in the MANIFEST.
+    VERSION_EDIT = 5
+};
+
+struct WalRecord {
+    RecordType type;
+    std::string key;
+    std::string value;
+};
+
+// A record as it lies in the mapped log.
+struct WalRecordView {
+    RecordType type;
+    std::string_view key;
+    std::string_view value;
+};
+
+class WAL {
+private:
+    // Set in the type byte of records that carry a CRC32C of their contents
+    // right after it.
+    static constexpr uint8_t CHECKSUM_FLAG = 0x80;
+    // Also set when the checksum is seeded with the number of the log the
+    // record was written to. A recycled file still holds records of the log
+    // it used to be past the new ones; those fail their checksum and end it.
+    static constexpr uint8_t LOG_NUMBER_FLAG = 0x40;
+
+    std::filesystem::path path_;
+    uint64_t logNumber_;
+    int fd_;
+    size_t fileSize_;
+    std::mutex fileMutex_;
+
+    static uint32_t seedFor(uint64_t logNumber);
+    bool parseRecord(const char*& next, const char* limit, WalRecordView& record, bool& numberedOnly) const;
+
+public:
+    // Records of a non-zero logNumber are tagged with it. A recycled file is
+    // written over from the start rather than appended to.
+    explicit WAL(const std::filesystem::path& path, uint64_t logNumber = 0, bool recycled = false);
+    ~WAL();
+
+    WAL(const WAL&) = delete;
+    WAL& operator=(const WAL&) = delete;
+
+    static void encodeRecord(std::string& dst, RecordType type, const std::string& key, const std::string& value, uint64_t logNumber = 0);
+
+    // Writes records encoded for this log with a single write call. Only
+    // one thread may append at a time; sync() may run concurrently with it.
+    void append(std::string_view records);
+
+    void logPut(const std::string& key, const std::string& value);
+    void logDelete(const std::string& key);
+    void sync();
+    // Makes file creations and renames in dir durable.
+    static void syncDirectory(const std::filesystem::path& dir);
+    // Reserves blocks for the first bytes of the log ahead of the writes
+    // that fill them, where the filesystem supports it.
+    void preallocate(size_t bytes);
+
+    // Maps the log and hands its records to handler in order, up to
+    // batchSize at a time, then truncates the file after the last complete
+    // one; a record failing its checksum ends the log. The views point into
+    // the mapping and are only valid during the call.
+    void replay(size_t batchSize, const std::function<void(const std::vector<WalRecordView>&)>& handler);
+
+    // Copies of every record replay() would hand over.
+    std::vector<WalRecord> recover();
+    uint64_t logNumber() const;
+    // Bytes of records written, which a recycled file may exceed.
+    size_t size() const;
+};
+
+}
+
 #endif
\ No newline at end of file
@@ -1,252 +1,1826 @@
-#include "db/DBImpl.hpp"
-#include <iostream>
-#include <cassert>
-#include <filesystem>
-
-using namespace lsmdb;
-
-void testBasicOperations() {
-    std::cout << "Testing basic operations...\n";
-    
-    std::filesystem::path dbPath = "/tmp/test_db_basic";
-    std::filesystem::remove_all(dbPath);
-    
-    {
-        DBImpl db(dbPath);
-        
-        db.put("key1", "value1");
-        db.put("key2", "value2");
-        db.put("key3", "value3");
-        
-        auto val1 = db.get("key1");
-        auto val2 = db.get("key2");
-        auto val3 = db.get("key3");
-        
-        assert(val1.has_value() && val1.value() == "value1");
-        assert(val2.has_value() && val2.value() == "value2");
-        assert(val3.has_value() && val3.value() == "value3");
-        
-        auto missing = db.get("nonexistent");
-        assert(!missing.has_value());
-        
-        std::cout << "  Put/Get works\n";
-    }
-    
-    std::filesystem::remove_all(dbPath);
-}
-
-void testUpdate() {
-    std::cout << "Testing updates...\n";
-    
-    std::filesystem::path dbPath = "/tmp/test_db_update";
-    std::filesystem::remove_all(dbPath);
-    
-    {
-        DBImpl db(dbPath);
-        
-        db.put("key", "value1");
-        auto v1 = db.get("key");
-        assert(v1.has_value() && v1.value() == "value1");
-        
-        db.put("key", "value2");
-        auto v2 = db.get("key");
-        assert(v2.has_value() && v2.value() == "value2");
-        
-        db.put("key", "value3");
-        auto v3 = db.get("key");
-        assert(v3.has_value() && v3.value() == "value3");
-        
-        std::cout << "  Updates work\n";
-    }
-    
-    std::filesystem::remove_all(dbPath);
-}
-
-void testDelete() {
-    std::cout << "Testing deletes...\n";
-    
-    std::filesystem::path dbPath = "/tmp/test_db_delete";
-    std::filesystem::remove_all(dbPath);
-    
-    {
-        DBImpl db(dbPath);
-        
-        db.put("key1", "value1");
-        db.put("key2", "value2");
-        
-        auto v1 = db.get("key1");
-        assert(v1.has_value());
-        
-        db.remove("key1");
-        auto v1_deleted = db.get("key1");
-        assert(!v1_deleted.has_value());
-        
-        auto v2 = db.get("key2");
-        assert(v2.has_value() && v2.value() == "value2");
-        
-        db.remove("nonexistent");
-        
-        std::cout << "  Deletes work\n";
-    }
-    
-    std::filesystem::remove_all(dbPath);
-}
-
-void testWALRecovery() {
-    std::cout << "Testing WAL recovery...\n";
-    
-    std::filesystem::path dbPath = "/tmp/test_db_recovery";
-    std::filesystem::remove_all(dbPath);
-    
-    {
-        DBImpl db(dbPath);
-        db.put("persistent1", "value1");
-        db.put("persistent2", "value2");
-        db.put("persistent3", "value3");
-        db.remove("persistent2");
-    }
-    
-    {
-        DBImpl db(dbPath);
-        
-        auto v1 = db.get("persistent1");
-        auto v2 = db.get("persistent2");
-        auto v3 = db.get("persistent3");
-        
-        assert(v1.has_value() && v1.value() == "value1");
-        assert(!v2.has_value());
-        assert(v3.has_value() && v3.value() == "value3");
-        
-        std::cout << "  WAL recovery works\n";
-    }
-    
-    std::filesystem::remove_all(dbPath);
-}
-
-void testLargeKeys() {
-    std::cout << "Testing large keys/values...\n";
-    
-    std::filesystem::path dbPath = "/tmp/test_db_large";
-    std::filesystem::remove_all(dbPath);
-    
-    {
-        DBImpl db(dbPath);
-        
-        std::string largeKey(1000, 'k');
-        std::string largeValue(10000, 'v');
-        
-        db.put(largeKey, largeValue);
-        auto retrieved = db.get(largeKey);
-        
-        assert(retrieved.has_value());
-        assert(retrieved.value() == largeValue);
-        
-        std::cout << "  Large keys/values work\n";
-    }
-    
-    std::filesystem::remove_all(dbPath);
-}
-
-void testManyOperations() {
-    std::cout << "Testing many operations...\n";
-    
-    std::filesystem::path dbPath = "/tmp/test_db_many";
-    std::filesystem::remove_all(dbPath);
-    
-    {
-        DBImpl db(dbPath);
-        
-        for(int i = 0; i < 1000; i++) {
-            std::string key = "key" + std::to_string(i);
-            std::string value = "value" + std::to_string(i);
-            db.put(key, value);
-        }
-        
-        for(int i = 0; i < 1000; i++) {
-            std::string key = "key" + std::to_string(i);
-            std::string expectedValue = "value" + std::to_string(i);
-            auto retrieved = db.get(key);
-            assert(retrieved.has_value());
-            assert(retrieved.value() == expectedValue);
-        }
-        
-        for(int i = 0; i < 500; i++) {
-            std::string key = "key" + std::to_string(i);
-            db.remove(key);
-        }
-        
-        for(int i = 0; i < 500; i++) {
-            std::string key = "key" + std::to_string(i);
-            auto retrieved = db.get(key);
-            assert(!retrieved.has_value());
-        }
-        
-        for(int i = 500; i < 1000; i++) {
-            std::string key = "key" + std::to_string(i);
-            auto retrieved = db.get(key);
-            assert(retrieved.has_value());
-        }
-        
-        std::cout << "  Many operations work\n";
-    }
-    
-    std::filesystem::remove_all(dbPath);
-}
-
-void testRecoveryAfterManyOps() {
-    std::cout << "Testing recovery after many ops...\n";
-    
-    std::filesystem::path dbPath = "/tmp/test_db_recovery_many";
-    std::filesystem::remove_all(dbPath);
-    
-    {
-        DBImpl db(dbPath);
-        
-        for(int i = 0; i < 100; i++) {
-            db.put("key" + std::to_string(i), "value" + std::to_string(i));
-        }
-        
-        for(int i = 0; i < 50; i++) {
-            db.remove("key" + std::to_string(i));
-        }
-    }
-    
-    {
-        DBImpl db(dbPath);
-        
-        for(int i = 0; i < 50; i++) {
-            auto v = db.get("key" + std::to_string(i));
-            assert(!v.has_value());
-        }
-        
-        for(int i = 50; i < 100; i++) {
-            auto v = db.get("key" + std::to_string(i));
-            assert(v.has_value());
-            assert(v.value() == "value" + std::to_string(i));
-        }
-        
-        std::cout << "  Recovery after many ops works\n";
-    }
-    
-    std::filesystem::remove_all(dbPath);
-}
-
-int main() {
-    std::cout << "Running LSM-DB tests...\n\n";
-    
-    try {
-        testBasicOperations();
-        testUpdate();
-        testDelete();
-        testWALRecovery();
-        testLargeKeys();
-        testManyOperations();
-        testRecoveryAfterManyOps();
-        
-        std::cout << "\nAll tests passed\n";
-        return 0;
-    } catch(const std::exception& e) {
-        std::cerr << "\nTest failed: " << e.what() << "\n";
-        return 1;
-    }
+#include "checksum/CRC32C.hpp"
+#include "compaction/Compaction.hpp"
+#include "db/DBImpl.hpp"
+#include "iterator/InternalIterator.hpp"
+#include "memtable/MemTable.hpp"
+#include "sstable/Compression.hpp"
+#include "sstable/SSTableBuilder.hpp"
+#include "version/Version.hpp"
+#include "wal/WAL.hpp"
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <filesystem>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace lsmdb;
+
+void testBasicOperations() {
+    std::cout << "Testing basic operations...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_basic";
+    std::filesystem::remove_all(dbPath);
+    
+    {
+        DBImpl db(dbPath);
+        
+        db.put("key1", "value1");
+        db.put("key2", "value2");
+        db.put("key3", "value3");
+        
+        auto val1 = db.get("key1");
+        auto val2 = db.get("key2");
+        auto val3 = db.get("key3");
+        
+        assert(val1.has_value() && val1.value() == "value1");
+        assert(val2.has_value() && val2.value() == "value2");
+        assert(val3.has_value() && val3.value() == "value3");
+        
+        auto missing = db.get("nonexistent");
+        assert(!missing.has_value());
+        
+        std::cout << "  Put/Get works\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testUpdate() {
+    std::cout << "Testing updates...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_update";
+    std::filesystem::remove_all(dbPath);
+    
+    {
+        DBImpl db(dbPath);
+        
+        db.put("key", "value1");
+        auto v1 = db.get("key");
+        assert(v1.has_value() && v1.value() == "value1");
+        
+        db.put("key", "value2");
+        auto v2 = db.get("key");
+        assert(v2.has_value() && v2.value() == "value2");
+        
+        db.put("key", "value3");
+        auto v3 = db.get("key");
+        assert(v3.has_value() && v3.value() == "value3");
+        
+        std::cout << "  Updates work\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testDelete() {
+    std::cout << "Testing deletes...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_delete";
+    std::filesystem::remove_all(dbPath);
+    
+    {
+        DBImpl db(dbPath);
+        
+        db.put("key1", "value1");
+        db.put("key2", "value2");
+        
+        auto v1 = db.get("key1");
+        assert(v1.has_value());
+        
+        db.remove("key1");
+        auto v1_deleted = db.get("key1");
+        assert(!v1_deleted.has_value());
+        
+        auto v2 = db.get("key2");
+        assert(v2.has_value() && v2.value() == "value2");
+        
+        db.remove("nonexistent");
+        
+        std::cout << "  Deletes work\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testWALRecovery() {
+    std::cout << "Testing WAL recovery...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_recovery";
+    std::filesystem::remove_all(dbPath);
+    
+    {
+        DBImpl db(dbPath);
+        db.put("persistent1", "value1");
+        db.put("persistent2", "value2");
+        db.put("persistent3", "value3");
+        db.remove("persistent2");
+    }
+    
+    {
+        DBImpl db(dbPath);
+        
+        auto v1 = db.get("persistent1");
+        auto v2 = db.get("persistent2");
+        auto v3 = db.get("persistent3");
+        
+        assert(v1.has_value() && v1.value() == "value1");
+        assert(!v2.has_value());
+        assert(v3.has_value() && v3.value() == "value3");
+        
+        std::cout << "  WAL recovery works\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testLargeKeys() {
+    std::cout << "Testing large keys/values...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_large";
+    std::filesystem::remove_all(dbPath);
+    
+    {
+        DBImpl db(dbPath);
+        
+        std::string largeKey(1000, 'k');
+        std::string largeValue(10000, 'v');
+        
+        db.put(largeKey, largeValue);
+        auto retrieved = db.get(largeKey);
+        
+        assert(retrieved.has_value());
+        assert(retrieved.value() == largeValue);
+        
+        std::cout << "  Large keys/values work\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testManyOperations() {
+    std::cout << "Testing many operations...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_many";
+    std::filesystem::remove_all(dbPath);
+    
+    {
+        DBImpl db(dbPath);
+        
+        for(int i = 0; i < 1000; i++) {
+            std::string key = "key" + std::to_string(i);
+            std::string value = "value" + std::to_string(i);
+            db.put(key, value);
+        }
+        
+        for(int i = 0; i < 1000; i++) {
+            std::string key = "key" + std::to_string(i);
+            std::string expectedValue = "value" + std::to_string(i);
+            auto retrieved = db.get(key);
+            assert(retrieved.has_value());
+            assert(retrieved.value() == expectedValue);
+        }
+        
+        for(int i = 0; i < 500; i++) {
+            std::string key = "key" + std::to_string(i);
+            db.remove(key);
+        }
+        
+        for(int i = 0; i < 500; i++) {
+            std::string key = "key" + std::to_string(i);
+            auto retrieved = db.get(key);
+            assert(!retrieved.has_value());
+        }
+        
+        for(int i = 500; i < 1000; i++) {
+            std::string key = "key" + std::to_string(i);
+            auto retrieved = db.get(key);
+            assert(retrieved.has_value());
+        }
+        
+        std::cout << "  Many operations work\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testRecoveryAfterManyOps() {
+    std::cout << "Testing recovery after many ops...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_recovery_many";
+    std::filesystem::remove_all(dbPath);
+    
+    {
+        DBImpl db(dbPath);
+        
+        for(int i = 0; i < 100; i++) {
+            db.put("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        
+        for(int i = 0; i < 50; i++) {
+            db.remove("key" + std::to_string(i));
+        }
+    }
+    
+    {
+        DBImpl db(dbPath);
+        
+        for(int i = 0; i < 50; i++) {
+            auto v = db.get("key" + std::to_string(i));
+            assert(!v.has_value());
+        }
+        
+        for(int i = 50; i < 100; i++) {
+            auto v = db.get("key" + std::to_string(i));
+            assert(v.has_value());
+            assert(v.value() == "value" + std::to_string(i));
+        }
+        
+        std::cout << "  Recovery after many ops works\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testCompaction() {
+    std::cout << "Testing compaction...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_compaction";
+    std::filesystem::remove_all(dbPath);
+    
+    Options options;
+    options.writeBufferSize = 16 * 1024;
+    options.maxBytesForLevelBase = 64 * 1024;
+    options.targetFileSize = 16 * 1024;
+    
+    {
+        DBImpl db(dbPath, options);
+        
+        for(int round = 0; round < 5; round++) {
+            for(int i = 0; i < 2000; i++) {
+                db.put("key" + std::to_string(i), "value" + std::to_string(i) + "_" + std::to_string(round));
+            }
+        }
+        db.waitForCompaction();
+        
+        assert(db.numTablesAtLevel(0) < static_cast<size_t>(options.level0CompactionTrigger));
+        
+        size_t deeperTables = 0;
+        for(int level = 1; level < 7; level++) {
+            deeperTables += db.numTablesAtLevel(level);
+        }
+        assert(deeperTables > 0);
+        
+        for(int i = 0; i < 2000; i++) {
+            auto v = db.get("key" + std::to_string(i));
+            assert(v.has_value());
+            assert(v.value() == "value" + std::to_string(i) + "_4");
+        }
+        
+        std::cout << "  Compaction keeps newest values\n";
+    }
+    
+    {
+        DBImpl db(dbPath, options);
+        
+        for(int i = 0; i < 2000; i++) {
+            auto v = db.get("key" + std::to_string(i));
+            assert(v.has_value());
+            assert(v.value() == "value" + std::to_string(i) + "_4");
+        }
+        
+        std::cout << "  Compacted levels survive reopen\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testBloomFilter() {
+    std::cout << "Testing bloom filters...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_bloom";
+    std::filesystem::remove_all(dbPath);
+    
+    Options options;
+    options.writeBufferSize = 16 * 1024;
+    options.bloomBitsPerKey = 0;
+    
+    {
+        DBImpl db(dbPath, options);
+        for(int i = 0; i < 1000; i++) {
+            db.put("old" + std::to_string(i), "value" + std::to_string(i));
+        }
+    }
+    
+    options.bloomBitsPerKey = 10;
+    options.statistics = std::make_shared<Statistics>();
+    
+    {
+        DBImpl db(dbPath, options);
+        for(int i = 0; i < 1000; i++) {
+            db.put("new" + std::to_string(i), "value" + std::to_string(i));
+        }
+        db.waitForCompaction();
+        
+        for(int i = 0; i < 1000; i++) {
+            auto oldValue = db.get("old" + std::to_string(i));
+            auto newValue = db.get("new" + std::to_string(i));
+            assert(oldValue.has_value() && oldValue.value() == "value" + std::to_string(i));
+            assert(newValue.has_value() && newValue.value() == "value" + std::to_string(i));
+        }
+        
+        options.statistics->reset();
+        for(int i = 0; i < 1000; i++) {
+            assert(!db.get("new" + std::to_string(i) + "_missing").has_value());
+        }
+        
+        uint64_t useful = options.statistics->get(Ticker::BLOOM_FILTER_USEFUL);
+        uint64_t falsePositives = options.statistics->get(Ticker::BLOOM_FILTER_FALSE_POSITIVE);
+        assert(useful > 0);
+        assert(falsePositives * 10 < useful);
+        
+        std::cout << "  Bloom filters skip tables on misses\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void writeLegacyTable(const std::filesystem::path& path, const std::vector<std::pair<std::string, std::string>>& entries) {
+    std::ofstream file(path, std::ios::binary);
+    std::vector<std::pair<std::string, uint64_t>> index;
+    
+    for(const auto& [key, value] : entries) {
+        index.push_back({key, static_cast<uint64_t>(file.tellp())});
+        uint8_t deletedFlag = 0;
+        uint32_t keySize = key.size();
+        uint32_t valueSize = value.size();
+        file.write(reinterpret_cast<const char*>(&deletedFlag), sizeof(deletedFlag));
+        file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+        file.write(key.data(), keySize);
+        file.write(reinterpret_cast<const char*>(&valueSize), sizeof(valueSize));
+        file.write(value.data(), valueSize);
+    }
+    
+    uint64_t indexStartOffset = file.tellp();
+    uint32_t indexSize = index.size();
+    file.write(reinterpret_cast<const char*>(&indexSize), sizeof(indexSize));
+    for(const auto& [key, offset] : index) {
+        uint32_t keySize = key.size();
+        file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+        file.write(key.data(), keySize);
+        file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    }
+    file.write(reinterpret_cast<const char*>(&indexStartOffset), sizeof(indexStartOffset));
+}
+
+void testBlockFormat() {
+    std::cout << "Testing block-based tables...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_blocks";
+    std::filesystem::remove_all(dbPath);
+    std::filesystem::create_directories(dbPath);
+    
+    std::vector<std::pair<std::string, std::string>> legacy;
+    for(int i = 0; i < 100; i++) {
+        legacy.push_back({"legacy" + std::to_string(1000 + i), "value" + std::to_string(i)});
+    }
+    writeLegacyTable(dbPath / "sstable_1.sst", legacy);
+    
+    Options options;
+    options.writeBufferSize = 16 * 1024;
+    
+    {
+        DBImpl db(dbPath, options);
+        
+        auto legacyValue = db.get("legacy1050");
+        assert(legacyValue.has_value() && legacyValue.value() == "value50");
+        assert(!db.get("legacy1050x").has_value());
+        
+        std::string bigValue(300, 'x');
+        for(int i = 0; i < 3000; i++) {
+            db.put("block" + std::to_string(100000 + i), bigValue + std::to_string(i));
+        }
+        db.waitForCompaction();
+        
+        for(int i = 0; i < 3000; i++) {
+            auto v = db.get("block" + std::to_string(100000 + i));
+            assert(v.has_value() && v.value() == bigValue + std::to_string(i));
+        }
+        assert(!db.get("block099999").has_value());
+        assert(!db.get("block1000005").has_value());
+        
+        for(int i = 0; i < 100; i++) {
+            auto v = db.get("legacy" + std::to_string(1000 + i));
+            assert(v.has_value() && v.value() == "value" + std::to_string(i));
+        }
+        
+        std::cout << "  Block-based and legacy tables both read\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testBlockCache() {
+    std::cout << "Testing block cache...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_block_cache";
+    std::filesystem::remove_all(dbPath);
+    
+    Options options;
+    options.writeBufferSize = 16 * 1024;
+    options.blockCacheCapacity = 1024 * 1024;
+    options.useMmapReads = false;
+    options.statistics = std::make_shared<Statistics>();
+    
+    {
+        DBImpl db(dbPath, options);
+        
+        for(int i = 0; i < 2000; i++) {
+            db.put("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        db.waitForCompaction();
+        
+        options.statistics->reset();
+        for(int round = 0; round < 10; round++) {
+            for(int i = 0; i < 100; i++) {
+                auto v = db.get("key" + std::to_string(i));
+                assert(v.has_value() && v.value() == "value" + std::to_string(i));
+            }
+        }
+        
+        uint64_t hits = options.statistics->get(Ticker::BLOCK_CACHE_HIT);
+        uint64_t misses = options.statistics->get(Ticker::BLOCK_CACHE_MISS);
+        assert(misses > 0);
+        assert(hits > misses * 5);
+        
+        std::cout << "  Repeated reads are served from the block cache\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testOpenFileLimit() {
+    std::cout << "Testing open file limit...\n";
+    
+    for(bool useMmap : {true, false}) {
+        std::filesystem::path dbPath = "/tmp/test_db_open_files";
+        std::filesystem::remove_all(dbPath);
+        
+        Options options;
+        options.writeBufferSize = 8 * 1024;
+        options.level0CompactionTrigger = 1000;
+        options.maxOpenFiles = 5;
+        options.useMmapReads = useMmap;
+        
+        DBImpl db(dbPath, options);
+        
+        for(int i = 0; i < 3000; i++) {
+            db.put("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+        assert(db.numTablesAtLevel(0) > options.maxOpenFiles);
+        
+        for(int round = 0; round < 2; round++) {
+            for(int i = 0; i < 3000; i++) {
+                auto v = db.get("key" + std::to_string(i));
+                assert(v.has_value() && v.value() == "value" + std::to_string(i));
+            }
+        }
+        
+        if(!useMmap) {
+            size_t openTables = 0;
+            for(const auto& fd : std::filesystem::directory_iterator("/proc/self/fd")) {
+                std::error_code ec;
+                auto target = std::filesystem::read_symlink(fd.path(), ec);
+                if(!ec && target.parent_path() == dbPath && target.extension() == ".sst") {
+                    openTables++;
+                }
+            }
+            assert(openTables > 0 && openTables <= options.maxOpenFiles);
+        }
+        
+        std::filesystem::remove_all(dbPath);
+    }
+    
+    std::cout << "  Reads work with more tables than open handles\n";
+}
+
+void testGroupCommit() {
+    std::cout << "Testing group commit...\n";
+    
+    for(WalSyncMode mode : {WalSyncMode::NONE, WalSyncMode::PERIODIC, WalSyncMode::EVERY_COMMIT}) {
+        std::filesystem::path dbPath = "/tmp/test_db_group_commit";
+        std::filesystem::remove_all(dbPath);
+        
+        Options options;
+        options.walSyncMode = mode;
+        options.walSyncIntervalMs = 5;
+        options.statistics = std::make_shared<Statistics>();
+        
+        const int numThreads = 4;
+        const int perThread = 200;
+        
+        {
+            DBImpl db(dbPath, options);
+            
+            std::vector<std::thread> threads;
+            for(int t = 0; t < numThreads; t++) {
+                threads.emplace_back([&db, t]() {
+                    for(int i = 0; i < perThread; i++) {
+                        db.put("t" + std::to_string(t) + "_" + std::to_string(i), "value" + std::to_string(i));
+                    }
+                });
+            }
+            for(auto& thread : threads) {
+                thread.join();
+            }
+            
+            uint64_t records = options.statistics->get(Ticker::WAL_RECORDS);
+            uint64_t groups = options.statistics->get(Ticker::WAL_GROUP_COMMITS);
+            assert(records == numThreads * perThread);
+            assert(groups > 0 && groups <= records);
+            if(mode == WalSyncMode::EVERY_COMMIT) {
+                assert(options.statistics->get(Ticker::WAL_SYNCS) >= groups);
+            }
+        }
+        
+        {
+            DBImpl db(dbPath, options);
+            for(int t = 0; t < numThreads; t++) {
+                for(int i = 0; i < perThread; i++) {
+                    auto v = db.get("t" + std::to_string(t) + "_" + std::to_string(i));
+                    assert(v.has_value() && v.value() == "value" + std::to_string(i));
+                }
+            }
+        }
+        
+        std::filesystem::remove_all(dbPath);
+    }
+    
+    std::cout << "  Concurrent writers commit in groups under every sync mode\n";
+}
+
+void testWriteBatch() {
+    std::cout << "Testing write batches...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_write_batch";
+    std::filesystem::remove_all(dbPath);
+    
+    {
+        DBImpl db(dbPath);
+        
+        WriteBatch first;
+        first.put("a", "1");
+        first.put("b", "2");
+        first.put("gone", "x");
+        assert(first.count() == 3);
+        db.write(first);
+        
+        WriteBatch second;
+        second.put("c", "3");
+        second.remove("a");
+        second.put("d", "4");
+        db.write(second);
+        
+        assert(!db.get("a").has_value());
+        assert(db.get("b").value() == "2");
+        assert(db.get("c").value() == "3");
+        assert(db.get("d").value() == "4");
+        
+        WriteBatch empty;
+        db.write(empty);
+        
+        std::cout << "  Batches apply in order\n";
+    }
+    
+    {
+        DBImpl db(dbPath);
+        assert(!db.get("a").has_value());
+        assert(db.get("b").value() == "2");
+        assert(db.get("d").value() == "4");
+    }
+    
+    // A torn final batch must be dropped as a whole.
+    std::filesystem::path walPath;
+    for(const auto& entry : std::filesystem::directory_iterator(dbPath)) {
+        if(entry.path().extension() == ".log") {
+            walPath = entry.path();
+        }
+    }
+    std::filesystem::resize_file(walPath, std::filesystem::file_size(walPath) - 1);
+    
+    {
+        DBImpl db(dbPath);
+        assert(db.get("a").value() == "1");
+        assert(db.get("b").value() == "2");
+        assert(!db.get("c").has_value());
+        assert(!db.get("d").has_value());
+        
+        std::cout << "  Torn batches are recovered atomically\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testIterator() {
+    std::cout << "Testing iterators...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_iterator";
+    std::filesystem::remove_all(dbPath);
+    
+    Options options;
+    options.writeBufferSize = 16 * 1024;
+    options.blockSize = 512;
+    
+    auto makeKey = [](int i) {
+        std::string n = std::to_string(i);
+        return "key" + std::string(5 - n.size(), '0') + n;
+    };
+    
+    {
+        DBImpl db(dbPath, options);
+        std::map<std::string, std::string> expected;
+        
+        for(int i = 0; i < 3000; i++) {
+            db.put(makeKey(i), "value" + std::to_string(i));
+            expected[makeKey(i)] = "value" + std::to_string(i);
+        }
+        db.waitForCompaction();
+        for(int i = 0; i < 3000; i += 3) {
+            db.put(makeKey(i), "updated" + std::to_string(i));
+            expected[makeKey(i)] = "updated" + std::to_string(i);
+        }
+        for(int i = 0; i < 3000; i += 7) {
+            db.remove(makeKey(i));
+            expected.erase(makeKey(i));
+        }
+        
+        auto it = db.newIterator();
+        auto exp = expected.begin();
+        for(it->seekToFirst(); it->valid(); it->next(), ++exp) {
+            assert(exp != expected.end());
+            assert(it->key() == exp->first && it->value() == exp->second);
+        }
+        assert(exp == expected.end());
+        std::cout << "  Forward scan matches " << expected.size() << " live keys\n";
+        
+        auto rexp = expected.rbegin();
+        for(it->seekToLast(); it->valid(); it->prev(), ++rexp) {
+            assert(rexp != expected.rend());
+            assert(it->key() == rexp->first && it->value() == rexp->second);
+        }
+        assert(rexp == expected.rend());
+        std::cout << "  Reverse scan matches\n";
+        
+        it->seek(makeKey(700));
+        assert(it->valid() && it->key() == makeKey(701));
+        it->prev();
+        assert(it->valid() && it->key() == makeKey(699));
+        it->next();
+        assert(it->valid() && it->key() == makeKey(701));
+        it->next();
+        assert(it->valid() && it->key() == makeKey(702));
+        std::cout << "  Seek skips tombstones and direction changes work\n";
+        
+        ReadOptions bounds;
+        bounds.lowerBound = makeKey(1000);
+        bounds.upperBound = makeKey(1100);
+        auto ranged = db.newIterator(bounds);
+        auto lo = expected.lower_bound(makeKey(1000));
+        auto hi = expected.lower_bound(makeKey(1100));
+        size_t count = 0;
+        for(ranged->seekToFirst(); ranged->valid(); ranged->next()) {
+            assert(lo != hi && ranged->key() == lo->first);
+            ++lo;
+            count++;
+        }
+        assert(lo == hi);
+        ranged->seekToLast();
+        assert(ranged->valid() && ranged->key() == std::prev(hi)->first);
+        ranged->seek(makeKey(5));
+        assert(ranged->valid() && ranged->key() == expected.lower_bound(makeKey(1000))->first);
+        std::cout << "  Bounded scan returned " << count << " keys\n";
+        
+        db.put(makeKey(1050), "new");
+        auto snapshot = db.newIterator();
+        for(int i = 0; i < 2000; i++) {
+            db.put(makeKey(5000 + i), "more");
+        }
+        snapshot->seek(makeKey(1050));
+        assert(snapshot->valid() && snapshot->value() == "new");
+        std::cout << "  Iterator survives flushes\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testBackgroundFlush() {
+    std::cout << "Testing background flush...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_background_flush";
+    std::filesystem::remove_all(dbPath);
+    
+    Options options;
+    options.writeBufferSize = 8 * 1024;
+    options.maxImmutableMemTables = 1;
+    options.statistics = std::make_shared<Statistics>();
+    
+    auto countLogs = [&dbPath](const std::string& prefix) {
+        size_t logs = 0;
+        for(const auto& entry : std::filesystem::directory_iterator(dbPath)) {
+            if(entry.path().extension() == ".log" && entry.path().filename().string().find(prefix) == 0) {
+                logs++;
+            }
+        }
+        return logs;
+    };
+    
+    {
+        DBImpl db(dbPath, options);
+        
+        for(int i = 0; i < 5000; i++) {
+            db.put("key" + std::to_string(i), "value" + std::to_string(i));
+            if(i % 500 == 0) {
+                for(int j = 0; j <= i; j += 97) {
+                    auto v = db.get("key" + std::to_string(j));
+                    assert(v.has_value() && v.value() == "value" + std::to_string(j));
+                }
+            }
+        }
+        std::cout << "  Reads see memtables queued for flushing\n";
+        
+        db.waitForCompaction();
+        assert(countLogs("wal_") == 1);
+        assert(countLogs("recycled_") == options.maxRecycledLogs);
+        std::cout << "  Logs of flushed memtables are retired\n";
+        
+        for(int i = 5000; i < 5100; i++) {
+            db.put("key" + std::to_string(i), "value" + std::to_string(i));
+        }
+    }
+    
+    {
+        DBImpl db(dbPath, options);
+        for(int i = 0; i < 5100; i += 7) {
+            auto v = db.get("key" + std::to_string(i));
+            assert(v.has_value() && v.value() == "value" + std::to_string(i));
+        }
+        std::cout << "  Unflushed writes are recovered from the logs\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testConcurrentWriters() {
+    std::cout << "Testing concurrent writers...\n";
+    
+    const int numThreads = 4;
+    const int perThread = 20000;
+    const int numKeys = 5000;
+    
+    {
+        MemTable memTable;
+        std::atomic<bool> writing{true};
+        
+        // Scans run alongside the writers and must always see versions in
+        // order: by key, then newest first.
+        std::thread reader([&]() {
+            while(writing.load()) {
+                auto it = memTable.newIterator();
+                std::string last;
+                uint64_t lastSequence = 0;
+                bool first = true;
+                for(it->seekToFirst(); it->valid(); it->next()) {
+                    assert(first || it->key() > last || (it->key() == last && it->sequence() < lastSequence));
+                    last = std::string(it->key());
+                    lastSequence = it->sequence();
+                    first = false;
+                }
+            }
+        });
+        
+        std::vector<std::thread> writers;
+        for(int t = 0; t < numThreads; t++) {
+            writers.emplace_back([&memTable, t]() {
+                for(int i = 0; i < perThread; i++) {
+                    uint64_t sequence = static_cast<uint64_t>(i) * numThreads + t + 1;
+                    memTable.put("key" + std::to_string(i % numKeys), std::to_string(sequence), sequence);
+                }
+            });
+        }
+        for(auto& writer : writers) {
+            writer.join();
+        }
+        writing = false;
+        reader.join();
+        
+        // Every key ends with the value of its highest sequence number.
+        for(int k = 0; k < numKeys; k++) {
+            int last = k + ((perThread - 1 - k) / numKeys) * numKeys;
+            uint64_t sequence = static_cast<uint64_t>(last) * numThreads + numThreads;
+            auto v = memTable.get("key" + std::to_string(k));
+            assert(v.has_value() && v.value() == std::to_string(sequence));
+        }
+        std::cout << "  Lock-free memtable inserts keep every key's newest version\n";
+    }
+    
+    std::filesystem::path dbPath = "/tmp/test_db_concurrent_writers";
+    std::filesystem::remove_all(dbPath);
+    
+    Options options;
+    options.writeBufferSize = 64 * 1024;
+    
+    {
+        DBImpl db(dbPath, options);
+        std::vector<std::thread> writers;
+        for(int t = 0; t < numThreads; t++) {
+            writers.emplace_back([&db, t]() {
+                for(int i = 0; i < 2000; i++) {
+                    std::string key = "t" + std::to_string(t) + "_" + std::to_string(i);
+                    db.put(key, "old");
+                    db.put(key, "value" + std::to_string(i));
+                    auto v = db.get(key);
+                    assert(v.has_value() && v.value() == "value" + std::to_string(i));
+                }
+            });
+        }
+        for(auto& writer : writers) {
+            writer.join();
+        }
+    }
+    
+    {
+        DBImpl db(dbPath, options);
+        for(int t = 0; t < numThreads; t++) {
+            for(int i = 0; i < 2000; i++) {
+                auto v = db.get("t" + std::to_string(t) + "_" + std::to_string(i));
+                assert(v.has_value() && v.value() == "value" + std::to_string(i));
+            }
+        }
+        std::cout << "  Concurrent writers keep their newest values across reopen\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testSnapshots() {
+    std::cout << "Testing snapshots...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_snapshots";
+    std::filesystem::remove_all(dbPath);
+    
+    Options options;
+    options.writeBufferSize = 16 * 1024;
+    options.level0CompactionTrigger = 2;
+    options.blockSize = 512;
+    
+    const int numKeys = 500;
+    uint64_t lastSequence;
+    
+    {
+        DBImpl db(dbPath, options);
+        for(int i = 0; i < numKeys; i++) {
+            db.put("key" + std::to_string(i), "v1");
+        }
+        
+        const Snapshot* snapshot = db.getSnapshot();
+        ReadOptions atSnapshot;
+        atSnapshot.snapshot = snapshot;
+        
+        db.put("key0", "v2");
+        db.remove("key1");
+        db.put("new", "v2");
+        assert(db.get("key0").value() == "v2");
+        assert(!db.get("key1").has_value());
+        assert(db.get(atSnapshot, "key0").value() == "v1");
+        assert(db.get(atSnapshot, "key1").value() == "v1");
+        assert(!db.get(atSnapshot, "new").has_value());
+        std::cout << "  Reads at a snapshot ignore later writes\n";
+        
+        // Rewrite everything until the old versions are flushed and compacted.
+        for(int round = 0; round < 10; round++) {
+            for(int i = 2; i < numKeys; i++) {
+                db.put("key" + std::to_string(i), "round" + std::to_string(round));
+            }
+        }
+        db.waitForCompaction();
+        assert(db.numTablesAtLevel(0) < 2);
+        for(int i = 0; i < numKeys; i++) {
+            assert(db.get(atSnapshot, "key" + std::to_string(i)).value() == "v1");
+        }
+        assert(db.get("key2").value() == "round9");
+        std::cout << "  Compaction keeps versions a snapshot can read\n";
+        
+        auto it = db.newIterator(atSnapshot);
+        int count = 0;
+        for(it->seekToFirst(); it->valid(); it->next()) {
+            assert(it->key() != "new" && it->value() == "v1");
+            count++;
+        }
+        assert(count == numKeys);
+        count = 0;
+        for(it->seekToLast(); it->valid(); it->prev()) {
+            assert(it->value() == "v1");
+            count++;
+        }
+        assert(count == numKeys);
+        
+        auto current = db.newIterator();
+        db.put("later", "v3");
+        current->seek("later");
+        assert(!current->valid() || current->key() != "later");
+        std::cout << "  Iterators read at their snapshot\n";
+        
+        db.releaseSnapshot(snapshot);
+        snapshot = db.getSnapshot();
+        lastSequence = snapshot->getSequenceNumber();
+        db.releaseSnapshot(snapshot);
+    }
+    
+    {
+        DBImpl db(dbPath, options);
+        const Snapshot* snapshot = db.getSnapshot();
+        assert(snapshot->getSequenceNumber() >= lastSequence);
+        db.put("key2", "after");
+        db.waitForCompaction();
+        assert(db.get("key2").value() == "after");
+        db.releaseSnapshot(snapshot);
+        std::cout << "  Sequence numbers survive reopening\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testManifest() {
+    std::cout << "Testing MANIFEST...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_manifest";
+    std::filesystem::remove_all(dbPath);
+    
+    Options options;
+    options.writeBufferSize = 8 * 1024;
+    options.level0CompactionTrigger = 100;
+    
+    std::array<size_t, TableSet::NUM_LEVELS> tablesPerLevel;
+    {
+        DBImpl db(dbPath, options);
+        for(int round = 0; round < 5; round++) {
+            for(int i = 0; i < 300; i++) {
+                db.put("key" + std::to_string(i), "round" + std::to_string(round));
+            }
+        }
+        db.waitForCompaction();
+        for(int level = 0; level < TableSet::NUM_LEVELS; level++) {
+            tablesPerLevel[level] = db.numTablesAtLevel(level);
+        }
+        assert(tablesPerLevel[0] > 1);
+    }
+    assert(std::filesystem::exists(dbPath / "MANIFEST"));
+    
+    // A table no version refers to, as left by a crash before its install.
+    for(const auto& entry : std::filesystem::directory_iterator(dbPath)) {
+        if(entry.path().extension() == ".sst") {
+            std::filesystem::copy_file(entry.path(), dbPath / "sstable_999999.sst");
+            break;
+        }
+    }
+    {
+        DBImpl db(dbPath, options);
+        for(int level = 0; level < TableSet::NUM_LEVELS; level++) {
+            assert(db.numTablesAtLevel(level) == tablesPerLevel[level]);
+        }
+        for(int i = 0; i < 300; i++) {
+            assert(db.get("key" + std::to_string(i)).value() == "round4");
+        }
+    }
+    assert(!std::filesystem::exists(dbPath / "sstable_999999.sst"));
+    std::cout << "  Table set and level-0 order survive reopening\n";
+    std::cout << "  Uninstalled tables are removed\n";
+    
+    // DBs written before the MANIFEST existed are still opened.
+    std::filesystem::remove(dbPath / "MANIFEST");
+    {
+        DBImpl db(dbPath, options);
+        assert(db.numTablesAtLevel(0) == tablesPerLevel[0]);
+        assert(db.get("key7").value() == "round4");
+    }
+    assert(std::filesystem::exists(dbPath / "MANIFEST"));
+    std::cout << "  Directories without a MANIFEST are upgraded\n";
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testSSTableBuilder() {
+    std::cout << "Testing SSTable builder...\n";
+    
+    std::filesystem::path dir = "/tmp/test_sstable_builder";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    
+    Options options;
+    options.blockSize = 256;
+    
+    // Many versions per key, so a key's versions straddle block boundaries.
+    {
+        SSTableBuilder builder(dir / "table.sst", options);
+        for(int i = 0; i < 200; i++) {
+            for(int version = 5; version >= 1; version--) {
+                builder.add("key" + std::to_string(1000 + i), "v" + std::to_string(version), false, i * 10 + version);
+            }
+        }
+        assert(!std::filesystem::exists(dir / "table.sst"));
+        builder.finish();
+        assert(builder.numEntries() == 1000);
+        assert(builder.fileSize() == std::filesystem::file_size(dir / "table.sst"));
+    }
+    
+    SSTable table(dir / "table.sst");
+    assert(table.size() == 1000);
+    assert(table.getLargestSequence() == 1995);
+    for(int i = 0; i < 200; i++) {
+        std::string key = "key" + std::to_string(1000 + i);
+        assert(table.get(key).value() == "v5");
+        assert(table.get(key, i * 10 + 3).value() == "v3");
+        assert(!table.get(key, i * 10).has_value());
+    }
+    std::cout << "  Streamed table reads back every version\n";
+    
+    {
+        SSTableBuilder builder(dir / "bad.sst", options);
+        builder.add("b", "1", false, 1);
+        bool threw = false;
+        try {
+            builder.add("a", "2", false, 2);
+        } catch(const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    assert(!std::filesystem::exists(dir / "bad.sst"));
+    assert(!std::filesystem::exists(dir / "bad.sst.tmp"));
+    std::cout << "  Out-of-order input is rejected and leaves no file\n";
+    
+    std::filesystem::remove_all(dir);
+}
+
+void testCompression() {
+    std::cout << "Testing block compression...\n";
+    
+    std::string repetitive;
+    for(int i = 0; i < 500; i++) {
+        repetitive += "{\"id\":" + std::to_string(i) + ",\"name\":\"user\",\"active\":true}";
+    }
+    std::string random;
+    std::mt19937 rng(42);
+    for(int i = 0; i < 5000; i++) {
+        random.push_back(static_cast<char>(rng()));
+    }
+    std::string small = "abcabcabcabcabcabc";
+    for(const std::string* input : {&repetitive, &random, &small}) {
+        std::string compressed;
+        std::string output;
+        LZCodec::compress(*input, compressed);
+        assert(LZCodec::decompress(compressed, output) && output == *input);
+        assert(!LZCodec::decompress(compressed.substr(0, compressed.size() / 2), output));
+    }
+    std::string compressed;
+    LZCodec::compress(repetitive, compressed);
+    assert(compressed.size() * 4 < repetitive.size());
+    // A block claiming 2 GiB from a few bytes is rejected before anything
+    // is allocated for it.
+    std::string output;
+    assert(!LZCodec::decompress(std::string("\x80\x80\x80\x80\x08\x10x", 7), output));
+    std::cout << "  Codec round-trips and rejects truncated input\n";
+    
+    auto dirSize = [](const std::filesystem::path& dir) {
+        uint64_t total = 0;
+        for(const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+            if(entry.path().extension() == ".sst") {
+                total += entry.file_size();
+            }
+        }
+        return total;
+    };
+    
+    std::filesystem::path plainPath = "/tmp/test_db_compression_none";
+    std::filesystem::path lzPath = "/tmp/test_db_compression_lz";
+    std::filesystem::remove_all(plainPath);
+    std::filesystem::remove_all(lzPath);
+    
+    auto makeValue = [](int i) {
+        return "{\"id\":" + std::to_string(i) + ",\"name\":\"user" + std::to_string(i % 10)
+            + "\",\"email\":\"user@example.com\",\"active\":true,\"tags\":[\"a\",\"b\"]}";
+    };
+    
+    Options options;
+    options.writeBufferSize = 64 * 1024;
+    for(auto [path, type] : {std::pair{plainPath, CompressionType::NONE}, std::pair{lzPath, CompressionType::LZ}}) {
+        options.compression = type;
+        DBImpl db(path, options);
+        for(int i = 0; i < 5000; i++) {
+            db.put("key" + std::to_string(i), makeValue(i));
+        }
+        db.waitForCompaction();
+    }
+    assert(dirSize(lzPath) * 2 < dirSize(plainPath));
+    std::cout << "  Compressed tables take " << dirSize(lzPath) << " bytes instead of " << dirSize(plainPath) << "\n";
+    
+    // The codec is stored per block, so the setting can change between opens.
+    options.compression = CompressionType::NONE;
+    options.useMmapReads = false;
+    {
+        DBImpl db(lzPath, options);
+        for(int i = 0; i < 5000; i += 13) {
+            assert(db.get("key" + std::to_string(i)).value() == makeValue(i));
+        }
+        auto it = db.newIterator();
+        int count = 0;
+        for(it->seekToFirst(); it->valid(); it->next()) {
+            count++;
+        }
+        assert(count == 5000);
+    }
+    std::cout << "  Compressed tables read back under any setting\n";
+    
+    std::filesystem::remove_all(plainPath);
+    std::filesystem::remove_all(lzPath);
+}
+
+void testPrefixKeys() {
+    std::cout << "Testing prefix-compressed keys...\n";
+    
+    std::filesystem::path dir = "/tmp/test_prefix_keys";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    
+    auto keyOf = [](int i) {
+        std::string digits = std::to_string(100000 + i * 2);
+        return "tenant/000042/orders/2024-06-01/" + digits;
+    };
+    
+    // A restart interval of 1 stores every key in full.
+    Options options;
+    options.blockSize = 512;
+    options.compression = CompressionType::NONE;
+    for(size_t interval : {size_t(1), size_t(16)}) {
+        options.blockRestartInterval = interval;
+        SSTableBuilder builder(dir / ("table" + std::to_string(interval) + ".sst"), options);
+        for(int i = 0; i < 2000; i++) {
+            // A few keys carry enough versions to straddle blocks.
+            int versions = i % 100 == 0 ? 40 : 1;
+            for(int version = versions; version >= 1; version--) {
+                builder.add(keyOf(i), "v" + std::to_string(version), false, i * 100 + version);
+            }
+        }
+        builder.finish();
+    }
+    uint64_t fullSize = std::filesystem::file_size(dir / "table1.sst");
+    uint64_t prefixSize = std::filesystem::file_size(dir / "table16.sst");
+    assert(prefixSize * 3 < fullSize * 2);
+    std::cout << "  Prefix-compressed table takes " << prefixSize << " bytes instead of " << fullSize << "\n";
+    
+    for(const char* name : {"table1.sst", "table16.sst"}) {
+        SSTable table(dir / name);
+        assert(table.getSmallestKey() == keyOf(0));
+        assert(table.getLargestKey() == keyOf(1999));
+        for(int i = 0; i < 2000; i += 7) {
+            assert(table.get(keyOf(i)).value() == (i % 100 == 0 ? "v40" : "v1"));
+            // Odd suffixes fall between stored keys.
+            assert(!table.get(keyOf(i) + "5").has_value());
+        }
+        for(int i = 0; i < 2000; i += 100) {
+            assert(table.get(keyOf(i), i * 100 + 17).value() == "v17");
+            assert(!table.get(keyOf(i), i * 100).has_value());
+        }
+        
+        auto it = table.newIterator();
+        it->seek(keyOf(500), 500 * 100 + 3);
+        assert(it->valid() && it->key() == keyOf(500) && it->value() == "v3");
+        it->seek(keyOf(700) + "5");
+        assert(it->valid() && it->key() == keyOf(701));
+        it->seek(keyOf(1999) + "5");
+        assert(!it->valid());
+        
+        std::vector<std::pair<std::string, uint64_t>> forward;
+        for(it->seekToFirst(); it->valid(); it->next()) {
+            forward.emplace_back(std::string(it->key()), it->sequence());
+        }
+        assert(forward.size() == table.size());
+        size_t count = 0;
+        for(it->seekToLast(); it->valid(); it->prev()) {
+            count++;
+            assert(forward[forward.size() - count] == std::make_pair(std::string(it->key()), it->sequence()));
+        }
+        assert(count == forward.size());
+    }
+    std::cout << "  Lookups, seeks and reverse scans agree with full keys\n";
+    
+    std::filesystem::remove_all(dir);
+}
+
+void testChecksums() {
+    std::cout << "Testing checksums...\n";
+    
+    // Reference value for CRC-32C over "123456789".
+    assert(CRC32C::value("123456789") == 0xe3069283);
+    assert(CRC32C::extend(CRC32C::value("1234"), "56789") == CRC32C::value("123456789"));
+    assert(CRC32C::unmask(CRC32C::mask(0xe3069283)) == 0xe3069283);
+    assert(CRC32C::mask(0xe3069283) != 0xe3069283);
+    std::cout << "  CRC32C matches the reference (" << (CRC32C::hardwareAccelerated() ? "SSE4.2" : "portable") << ")\n";
+    
+    std::filesystem::path dir = "/tmp/test_checksums";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    
+    auto flipByte = [](const std::filesystem::path& path, std::streamoff offset) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(offset);
+        char byte = static_cast<char>(file.get());
+        file.seekp(offset);
+        file.put(static_cast<char>(byte ^ 0x5a));
+    };
+    
+    // Each record is [type][crc][key size]["k"][value size]["v"].
+    const std::streamoff recordSize = 1 + 4 + 4 + 1 + 4 + 1;
+    {
+        WAL wal(dir / "wal.log");
+        wal.logPut("a", "1");
+        wal.logPut("b", "2");
+        wal.logPut("c", "3");
+    }
+    flipByte(dir / "wal.log", recordSize + recordSize - 1);
+    {
+        WAL wal(dir / "wal.log");
+        auto records = wal.recover();
+        assert(records.size() == 1 && records[0].key == "a");
+        assert(std::filesystem::file_size(dir / "wal.log") == static_cast<uint64_t>(recordSize));
+    }
+    
+    // A corrupt key size must not be trusted for an allocation.
+    std::filesystem::remove(dir / "wal.log");
+    {
+        WAL wal(dir / "wal.log");
+        wal.logPut("a", "1");
+    }
+    {
+        std::fstream file(dir / "wal.log", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(5);
+        uint32_t hugeSize = 0xfffffff0;
+        file.write(reinterpret_cast<const char*>(&hugeSize), sizeof(hugeSize));
+    }
+    {
+        WAL wal(dir / "wal.log");
+        assert(wal.recover().empty());
+    }
+    std::cout << "  WAL recovery stops at a corrupt record\n";
+    
+    Options options;
+    options.blockSize = 256;
+    options.compression = CompressionType::NONE;
+    {
+        SSTableBuilder builder(dir / "table.sst", options);
+        for(int i = 0; i < 100; i++) {
+            builder.add("key" + std::to_string(1000 + i), "value" + std::to_string(1000 + i), false, i + 1);
+        }
+        builder.finish();
+    }
+    std::string contents;
+    {
+        std::ifstream file(dir / "table.sst", std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    flipByte(dir / "table.sst", contents.find("value1042") + 5);
+    
+    SSTable table(dir / "table.sst");
+    bool threw = false;
+    try {
+        table.get("key1042");
+    } catch(const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    auto unchecked = table.get("key1042", UINT64_MAX, false);
+    assert(unchecked.has_value() && *unchecked != "value1042");
+    assert(table.get("key1099").value() == "value1099");
+    std::cout << "  Corrupt table blocks are detected on read\n";
+    
+    std::filesystem::remove_all(dir);
+}
+
+void testLargeWALRecovery() {
+    std::cout << "Testing large WAL recovery...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_large_recovery";
+    std::filesystem::remove_all(dbPath);
+    
+    // Enough records for several replay batches, with every key written
+    // more than once so replay must keep the newest version.
+    std::map<std::string, std::string> expected;
+    {
+        DBImpl db(dbPath);
+        for(int round = 0; round < 3; round++) {
+            for(int i = 0; i < 50000; i++) {
+                std::string key = "key" + std::to_string(i);
+                std::string value = "value" + std::to_string(round) + "_" + std::to_string(i);
+                if(round == 2 && i % 7 == 0) {
+                    db.remove(key);
+                    expected.erase(key);
+                } else if(i % 100 == 0) {
+                    WriteBatch batch;
+                    batch.put(key, value);
+                    batch.put(key + "b", value);
+                    db.write(batch);
+                    expected[key] = value;
+                    expected[key + "b"] = value;
+                } else {
+                    db.put(key, value);
+                    expected[key] = value;
+                }
+            }
+        }
+    }
+    
+    {
+        DBImpl db(dbPath);
+        auto it = db.newIterator();
+        auto expectedIt = expected.begin();
+        for(it->seekToFirst(); it->valid(); it->next(), ++expectedIt) {
+            assert(expectedIt != expected.end());
+            assert(it->key() == expectedIt->first && it->value() == expectedIt->second);
+        }
+        assert(expectedIt == expected.end());
+        
+        // Sequence numbers carry on from the log.
+        const Snapshot* snapshot = db.getSnapshot();
+        db.put("key1", "after");
+        ReadOptions options;
+        options.snapshot = snapshot;
+        assert(db.get(options, "key1").value() == expected["key1"]);
+        assert(db.get("key1").value() == "after");
+        db.releaseSnapshot(snapshot);
+    }
+    std::cout << "  Replayed " << expected.size() << " keys from the log\n";
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testLogRecycling() {
+    std::cout << "Testing log recycling...\n";
+    
+    std::filesystem::path dir = "/tmp/test_log_recycling";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    
+    {
+        WAL wal(dir / "wal_5.log", 5);
+        for(int i = 0; i < 100; i++) {
+            wal.logPut("old" + std::to_string(i), std::string(100, 'o'));
+        }
+    }
+    uint64_t oldSize = std::filesystem::file_size(dir / "wal_5.log");
+    
+    // Written over from the start: the old records past the new ones are
+    // tagged with another log number and end the log.
+    std::filesystem::rename(dir / "wal_5.log", dir / "wal_9.log");
+    {
+        WAL wal(dir / "wal_9.log", 9, true);
+        assert(wal.size() == 0);
+        wal.logPut("new1", "a");
+        wal.logPut("new2", "b");
+    }
+    assert(std::filesystem::file_size(dir / "wal_9.log") == oldSize);
+    {
+        WAL wal(dir / "wal_9.log", 9);
+        auto records = wal.recover();
+        assert(records.size() == 2 && records[0].key == "new1" && records[1].key == "new2");
+    }
+    
+    // Nothing new written: none of the old records survive.
+    std::filesystem::rename(dir / "wal_9.log", dir / "wal_12.log");
+    {
+        WAL wal(dir / "wal_12.log", 12, true);
+    }
+    {
+        WAL wal(dir / "wal_12.log", 12);
+        assert(wal.recover().empty());
+    }
+    std::cout << "  Stale records of a recycled log are never replayed\n";
+    
+    std::filesystem::remove_all(dir);
+}
+
+void testTombstoneLookup() {
+    std::cout << "Testing tombstone lookups...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_tombstone_lookup";
+    std::filesystem::remove_all(dbPath);
+    
+    Options options;
+    options.writeBufferSize = 8 * 1024;
+    options.level0CompactionTrigger = 100;
+    options.statistics = std::make_shared<Statistics>();
+    
+    {
+        DBImpl db(dbPath, options);
+        db.put("victim", "stale");
+        for(int i = 0; i < 500; i++) {
+            db.put("filler_a" + std::to_string(i), std::string(32, 'a'));
+        }
+        db.waitForCompaction();
+        
+        db.remove("victim");
+        for(int i = 0; i < 500; i++) {
+            db.put("filler_b" + std::to_string(i), std::string(32, 'b'));
+        }
+        db.waitForCompaction();
+        
+        // The older table still holds the value; the newer tombstone must
+        // hide it without the older table being consulted.
+        options.statistics->reset();
+        for(int i = 0; i < 100; i++) {
+            assert(!db.get("victim").has_value());
+        }
+        uint64_t positives = options.statistics->get(Ticker::BLOOM_FILTER_POSITIVE);
+        uint64_t falsePositives = options.statistics->get(Ticker::BLOOM_FILTER_FALSE_POSITIVE);
+        assert(positives - falsePositives == 100);
+        
+        db.put("victim", "fresh");
+        auto v = db.get("victim");
+        assert(v.has_value() && v.value() == "fresh");
+        std::cout << "  Lookups stop at the newest table holding a tombstone\n";
+    }
+    
+    {
+        DBImpl db(dbPath, options);
+        auto v = db.get("victim");
+        assert(v.has_value() && v.value() == "fresh");
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testMultiGet() {
+    std::cout << "Testing multiGet...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_multiget";
+    std::filesystem::remove_all(dbPath);
+    
+    Options options;
+    options.writeBufferSize = 16 * 1024;
+    options.targetFileSize = 16 * 1024;
+    options.maxBytesForLevelBase = 64 * 1024;
+    
+    {
+        DBImpl db(dbPath, options);
+        std::map<std::string, std::string> expected;
+        for(int i = 0; i < 4000; i++) {
+            std::string key = "key" + std::to_string(i);
+            db.put(key, "value" + std::to_string(i));
+            expected[key] = "value" + std::to_string(i);
+        }
+        db.waitForCompaction();
+        assert(db.numTablesAtLevel(1) + db.numTablesAtLevel(2) > 0);
+        
+        // Newer versions and tombstones, some still in L0 or the memtable.
+        for(int i = 0; i < 4000; i += 7) {
+            std::string key = "key" + std::to_string(i);
+            db.put(key, "updated" + std::to_string(i));
+            expected[key] = "updated" + std::to_string(i);
+        }
+        for(int i = 3; i < 4000; i += 11) {
+            std::string key = "key" + std::to_string(i);
+            db.remove(key);
+            expected.erase(key);
+        }
+        
+        const Snapshot* snapshot = db.getSnapshot();
+        auto snapshotExpected = expected;
+        for(int i = 0; i < 4000; i += 13) {
+            std::string key = "key" + std::to_string(i);
+            db.put(key, "latest");
+            expected[key] = "latest";
+        }
+        
+        std::vector<std::string> keys;
+        for(int i = 0; i < 4200; i += 3) {
+            keys.push_back("key" + std::to_string(i));
+        }
+        keys.push_back("key14");
+        keys.push_back("key14");
+        keys.push_back("");
+        std::mt19937 rng(42);
+        std::shuffle(keys.begin(), keys.end(), rng);
+        
+        auto values = db.multiGet(keys);
+        assert(values.size() == keys.size());
+        for(size_t i = 0; i < keys.size(); i++) {
+            auto it = expected.find(keys[i]);
+            assert(values[i] == (it == expected.end() ? std::nullopt : std::optional<std::string>(it->second)));
+            assert(values[i] == db.get(keys[i]));
+        }
+        
+        ReadOptions readOptions;
+        readOptions.snapshot = snapshot;
+        values = db.multiGet(readOptions, keys);
+        for(size_t i = 0; i < keys.size(); i++) {
+            auto it = snapshotExpected.find(keys[i]);
+            assert(values[i] == (it == snapshotExpected.end() ? std::nullopt : std::optional<std::string>(it->second)));
+        }
+        db.releaseSnapshot(snapshot);
+        
+        assert(db.multiGet(std::vector<std::string>()).empty());
+        std::cout << "  Batched lookups match get() across memtables, levels and snapshots\n";
+    }
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testAsyncGet() {
+    std::cout << "Testing asynchronous gets...\n";
+    
+    std::filesystem::path dbPath = "/tmp/test_db_async_get";
+    
+    for(int mode = 0; mode < 3; mode++) {
+        std::filesystem::remove_all(dbPath);
+        Options options;
+        options.writeBufferSize = 16 * 1024;
+        options.useMmapReads = mode == 2;
+        options.blockCacheCapacity = mode == 0 ? 0 : 1024 * 1024;
+        options.asyncReadQueueDepth = 8;
+        
+        DBImpl db(dbPath, options);
+        std::map<std::string, std::string> expected;
+        for(int i = 0; i < 3000; i++) {
+            std::string key = "key" + std::to_string(i);
+            db.put(key, "value" + std::to_string(i));
+            expected[key] = "value" + std::to_string(i);
+        }
+        for(int i = 0; i < 3000; i += 5) {
+            std::string key = "key" + std::to_string(i);
+            db.remove(key);
+            expected.erase(key);
+        }
+        db.waitForCompaction();
+        db.put("key1", "fresh");
+        expected["key1"] = "fresh";
+        
+        // Far more lookups in flight than the queue depth.
+        std::vector<std::string> keys;
+        std::vector<std::future<std::optional<std::string>>> futures;
+        for(int i = 0; i < 3200; i++) {
+            keys.push_back("key" + std::to_string(i));
+            futures.push_back(db.getAsync(keys.back()));
+        }
+        for(size_t i = 0; i < keys.size(); i++) {
+            auto it = expected.find(keys[i]);
+            auto value = futures[i].get();
+            assert(value == (it == expected.end() ? std::nullopt : std::optional<std::string>(it->second)));
+        }
+        
+        // Lookups still in flight are finished before the DB goes away.
+        for(int i = 0; i < 100; i++) {
+            db.getAsync("key" + std::to_string(i));
+        }
+    }
+    std::cout << "  Asynchronous gets match get() with and without mapped tables\n";
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testMemTableHashIndex() {
+    std::cout << "Testing memtable hash index...\n";
+    
+    {
+        // Few buckets, so chains are long; every answer must match a plain
+        // memtable's, at every sequence number.
+        MemTable plain;
+        MemTable indexed(16);
+        std::mt19937 rng(5);
+        uint64_t sequence = 0;
+        for(int i = 0; i < 5000; i++) {
+            std::string key = "key" + std::to_string(rng() % 500);
+            sequence++;
+            if(rng() % 4 == 0) {
+                plain.remove(key, sequence);
+                indexed.remove(key, sequence);
+            } else {
+                plain.put(key, std::to_string(sequence), sequence);
+                indexed.put(key, std::to_string(sequence), sequence);
+            }
+        }
+        for(int k = 0; k < 520; k++) {
+            std::string key = "key" + std::to_string(k);
+            for(uint64_t at : {uint64_t(0), uint64_t(1000), uint64_t(4321), sequence, SkipList::MAX_SEQUENCE}) {
+                LookupResult expected = plain.lookup(key, at);
+                LookupResult actual = indexed.lookup(key, at);
+                assert(expected.state == actual.state && expected.value == actual.value);
+                assert(plain.isDeleted(key, at) == indexed.isDeleted(key, at));
+            }
+        }
+    }
+    
+    {
+        // Versions of the same keys inserted from several threads at once.
+        MemTable memTable(64);
+        const int numThreads = 4;
+        const int perThread = 20000;
+        const int numKeys = 1000;
+        std::vector<std::thread> writers;
+        for(int t = 0; t < numThreads; t++) {
+            writers.emplace_back([&memTable, t]() {
+                for(int i = 0; i < perThread; i++) {
+                    uint64_t sequence = static_cast<uint64_t>(i) * numThreads + t + 1;
+                    memTable.put("key" + std::to_string(i % numKeys), std::to_string(sequence), sequence);
+                }
+            });
+        }
+        for(auto& writer : writers) {
+            writer.join();
+        }
+        for(int k = 0; k < numKeys; k++) {
+            int last = k + ((perThread - 1 - k) / numKeys) * numKeys;
+            uint64_t sequence = static_cast<uint64_t>(last) * numThreads + numThreads;
+            auto v = memTable.get("key" + std::to_string(k));
+            assert(v.has_value() && v.value() == std::to_string(sequence));
+        }
+    }
+    
+    std::filesystem::path dbPath = "/tmp/test_db_hash_index";
+    std::filesystem::remove_all(dbPath);
+    
+    Options options;
+    options.memTableHashIndex = true;
+    options.writeBufferSize = 64 * 1024;
+    
+    {
+        DBImpl db(dbPath, options);
+        for(int i = 0; i < 2000; i++) {
+            db.put("key" + std::to_string(i), "old");
+        }
+        const Snapshot* snapshot = db.getSnapshot();
+        for(int i = 0; i < 2000; i += 2) {
+            db.put("key" + std::to_string(i), "new");
+        }
+        for(int i = 0; i < 2000; i += 3) {
+            db.remove("key" + std::to_string(i));
+        }
+        
+        ReadOptions readOptions;
+        readOptions.snapshot = snapshot;
+        for(int i = 0; i < 2000; i++) {
+            std::string key = "key" + std::to_string(i);
+            auto v = db.get(key);
+            if(i % 3 == 0) {
+                assert(!v.has_value());
+            } else {
+                assert(v.has_value() && v.value() == (i % 2 == 0 ? "new" : "old"));
+            }
+            auto old = db.get(readOptions, key);
+            assert(old.has_value() && old.value() == "old");
+        }
+        assert(!db.get("key2000").has_value());
+        db.releaseSnapshot(snapshot);
+    }
+    
+    {
+        DBImpl db(dbPath, options);
+        auto v = db.get("key1");
+        assert(v.has_value() && v.value() == "old");
+        assert(!db.get("key3").has_value());
+    }
+    std::cout << "  Indexed lookups match the skiplist at every sequence number\n";
+    
+    std::filesystem::remove_all(dbPath);
+}
+
+void testSkipListKeyPrefixes() {
+    std::cout << "Testing skiplist key prefixes...\n";
+    
+    // Keys equal in their first eight bytes, or differing only in trailing
+    // zero bytes, fall back to full comparisons.
+    std::vector<std::string> keys = {
+        "", "a", std::string("a\0", 2), std::string("a\0\0", 3), "ab", "abcdefgh", "abcdefgh1",
+        "abcdefgh0", "abcdefghij", "abcdefgg", std::string("abcdefgh\0", 9), "\xff", "\xff\xff", "b",
+        "key1", "key10", "key100000000", "key099999999"
+    };
+    MemTable memTable;
+    uint64_t sequence = 0;
+    for(const auto& key : keys) {
+        memTable.put(key, key, ++sequence);
+    }
+    std::sort(keys.begin(), keys.end());
+    
+    auto it = memTable.newIterator();
+    size_t i = 0;
+    for(it->seekToFirst(); it->valid(); it->next(), i++) {
+        assert(i < keys.size() && it->key() == keys[i]);
+    }
+    assert(i == keys.size());
+    for(const auto& key : keys) {
+        auto v = memTable.get(key);
+        assert(v.has_value() && v.value() == key);
+    }
+    assert(!memTable.get("abcdefgh2").has_value());
+    std::cout << "  Inline prefixes keep keys in byte order\n";
+}
+
+void testCompactionKeepsTombstones() {
+    std::cout << "Testing tombstones in compaction parents...\n";
+    
+    std::filesystem::path dir = "/tmp/test_db_compaction_tombstones";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    
+    Options options;
+    options.level0CompactionTrigger = 1;
+    auto makeTable = [&](uint64_t number, const std::vector<SSTableEntry>& entries) {
+        auto path = dir / (std::to_string(number) + ".sst");
+        SSTable::create(path, entries, options);
+        return TableFile{number, std::make_shared<SSTable>(path)};
+    };
+    
+    // The level 1 parent reaches past the level 0 input and holds a
+    // tombstone for a key with an older value at level 2.
+    TableSet tables;
+    tables.levels[0].push_back(makeTable(3, {{"c", "c", false, 6}, {"d", "d", false, 7}}));
+    tables.levels[1].push_back(makeTable(2, {{"a", "a", false, 3}, {"x", "", true, 4}, {"z", "z", false, 5}}));
+    tables.levels[2].push_back(makeTable(1, {{"x", "old", false, 1}}));
+    
+    Compaction compaction(options, TableContext());
+    auto job = compaction.pick(tables);
+    assert(job && job->level == 0 && job->parents.size() == 1);
+    job->smallestSnapshot = UINT64_MAX;
+    uint64_t nextNumber = 4;
+    auto outputs = compaction.run(*job, [&](int) {
+        uint64_t number = nextNumber++;
+        return std::pair{number, dir / (std::to_string(number) + ".sst")};
+    });
+    
+    bool tombstoneKept = false;
+    for(const auto& output : outputs) {
+        tombstoneKept = tombstoneKept || output.table->lookup("x").state == LookupResult::State::DELETED;
+    }
+    assert(tombstoneKept);
+    // No snapshot at all is not a reason to drop the only version of a key.
+    for(const char* key : {"a", "c", "d", "z"}) {
+        bool found = false;
+        for(const auto& output : outputs) {
+            found = found || output.table->get(key) == std::string(key);
+        }
+        assert(found);
+    }
+    std::cout << "  A tombstone over a deeper value survives compaction\n";
+    
+    outputs.clear();
+    job.reset();
+    tables = TableSet();
+    std::filesystem::remove_all(dir);
+}
+
+int main() {
+    std::cout << "Running LSM-DB tests...\n\n";
+    
+    try {
+        testBasicOperations();
+        testUpdate();
+        testDelete();
+        testWALRecovery();
+        testLargeKeys();
+        testManyOperations();
+        testRecoveryAfterManyOps();
+        testCompaction();
+        testBloomFilter();
+        testBlockFormat();
+        testBlockCache();
+        testOpenFileLimit();
+        testGroupCommit();
+        testWriteBatch();
+        testIterator();
+        testBackgroundFlush();
+        testConcurrentWriters();
+        testSnapshots();
+        testManifest();
+        testSSTableBuilder();
+        testCompression();
+        testPrefixKeys();
+        testChecksums();
+        testLargeWALRecovery();
+        testLogRecycling();
+        testTombstoneLookup();
+        testMultiGet();
+        testAsyncGet();
+        testMemTableHashIndex();
+        testSkipListKeyPrefixes();
+        testCompactionKeepsTombstones();
+        
+        std::cout << "\nAll tests passed\n";
+        return 0;
+    } catch(const std::exception& e) {
+        std::cerr << "\nTest failed: " << e.what() << "\n";
+        return 1;
+    }
 }
\ No newline at end of file